@@ -0,0 +1,122 @@
+// Measures `parse_request()` and `parse_response()` over a few typical
+// messages, and `parse_request<Capture::Path>()` for routing-only use.
+// Run it before and after a change to the parsing code to see what the
+// change is worth.
+//
+// Usage: parse_benchmark [iterations]
+
+#include "http/http.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+namespace {
+
+    std::string const SMALL_GET = 
+        "GET /index.html HTTP/1.1\r\n"
+        "Host: www.example.com\r\n"
+        "\r\n";
+
+    std::string const BROWSER_GET = 
+        "GET /api/v1/users/42/orders?page=2&sort=desc HTTP/1.1\r\n"
+        "Host: api.example.com\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) "
+            "Gecko/20100101 Firefox/115.0\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;"
+            "q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+        "Accept-Language: en-GB,en;q=0.5\r\n"
+        "Accept-Encoding: gzip, deflate, br\r\n"
+        "Referer: https://www.example.com/account\r\n"
+        "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark; "
+            "consent=yes\r\n"
+        "Connection: keep-alive\r\n"
+        "Upgrade-Insecure-Requests: 1\r\n"
+        "Sec-Fetch-Dest: document\r\n"
+        "Sec-Fetch-Mode: navigate\r\n"
+        "Sec-Fetch-Site: same-origin\r\n"
+        "\r\n";
+
+    auto make_chunked_post() -> std::string {
+        auto message = std::string {
+            "POST /upload HTTP/1.1\r\n"
+            "Host: api.example.com\r\n"
+            "Content-Type: application/octet-stream\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "\r\n"
+        };
+
+        for (auto i = 0; i < 16; ++i) {
+            message += "400\r\n";
+            message += std::string(0x400, 'x');
+            message += "\r\n";
+        }
+
+        return message + "0\r\n\r\n";
+    }
+
+    std::string const RESPONSE = 
+        "HTTP/1.1 200 OK\r\n"
+        "Date: Mon, 19 Oct 2026 10:00:00 GMT\r\n"
+        "Server: example\r\n"
+        "Content-Type: application/json\r\n"
+        "Cache-Control: no-cache\r\n"
+        "Content-Length: 27\r\n"
+        "\r\n"
+        "{\"id\":42,\"name\":\"example\"}\n";
+
+    template<typename F>
+    auto measure(char const* name, 
+                 std::string const& message, 
+                 size_t iterations,
+                 F&& parse) -> void
+    {
+        using Clock = std::chrono::steady_clock;
+
+        auto parsed = size_t { 0 };
+        auto const start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            parsed += parse(message) ? 1 : 0;
+        }
+        auto const elapsed = Clock::now() - start;
+
+        auto const ns = static_cast<double>(
+            std::chrono::duration_cast<
+                std::chrono::nanoseconds>(elapsed).count());
+
+        std::cout << name << ": "
+                  << (ns / iterations) << " ns/message, "
+                  << (message.size() * iterations * 1e3 / ns) << " MB/s, "
+                  << parsed << "/" << iterations << " parsed\n";
+    }
+}
+
+auto main(int argc, char** argv) -> int {
+    auto const iterations = argc > 1 
+        ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) 
+        : static_cast<size_t>(200000);
+
+    auto const request = [](std::string const& m) {
+        return http::parse_request(m.begin(), m.end()).is_ok();
+    };
+
+    auto const route_only = [](std::string const& m) {
+        return http::parse_request<http::Capture::Path>(
+            m.begin(), m.end()).is_ok();
+    };
+
+    auto const response = [](std::string const& m) {
+        return http::parse_response(m.begin(), m.end()).is_ok();
+    };
+
+    measure("small request", SMALL_GET, iterations, request);
+    measure("browser request", BROWSER_GET, iterations, request);
+    measure("browser request, path only", 
+            BROWSER_GET, 
+            iterations, 
+            route_only);
+    measure("chunked upload", make_chunked_post(), iterations / 10, request);
+    measure("response", RESPONSE, iterations, response);
+
+    return 0;
+}
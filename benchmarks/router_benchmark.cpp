@@ -0,0 +1,201 @@
+// Compares `http::Router` against a linear list of regular expressions,
+// which is what it replaces, over a large table of REST-style routes.
+//
+// Usage: router_benchmark [iterations]
+
+#include "http/router.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace {
+
+    struct Route {
+        http::Method method;
+        std::string pattern;
+    };
+
+    struct RegexRoute {
+        http::Method method;
+        std::regex expression;
+        size_t index;
+    };
+
+    // Builds ~800 routes resembling a large REST API: many resources,
+    // each with collection, item and nested sub-resource routes...
+    auto make_routes() -> std::vector<Route> {
+        static char const* const resources[] = {
+            "users", "accounts", "orders", "invoices", "products",
+            "customers", "payments", "shipments", "carts", "reviews",
+            "categories", "coupons", "refunds", "subscriptions", "plans",
+            "teams", "projects", "tasks", "comments", "attachments",
+            "webhooks", "events", "sessions", "tokens", "devices",
+        };
+
+        static char const* const children[] = {
+            "items", "notes", "history", "members", "tags", "settings",
+        };
+
+        auto routes = std::vector<Route> { };
+        for (auto const* r : resources) {
+            auto base = std::string { "/api/v1/" } + r;
+            auto item = base + "/:id";
+
+            routes.push_back({ http::Method::Get, base });
+            routes.push_back({ http::Method::Post, base });
+            routes.push_back({ http::Method::Get, base + "/search" });
+            routes.push_back({ http::Method::Get, item });
+            routes.push_back({ http::Method::Put, item });
+            routes.push_back({ http::Method::Delete, item });
+
+            for (auto const* c : children) {
+                auto sub = item + "/" + c;
+                routes.push_back({ http::Method::Get, sub });
+                routes.push_back({ http::Method::Post, sub });
+                routes.push_back({ http::Method::Get, sub + "/:child" });
+                routes.push_back({ http::Method::Delete, sub + "/:child" });
+            }
+        }
+
+        for (auto const* v : { "/api/v2/", "/internal/" }) {
+            for (auto const* r : resources) {
+                routes.push_back({ http::Method::Get, std::string { v } + r });
+                routes.push_back({ 
+                    http::Method::Get, 
+                    std::string { v } + r + "/:id" 
+                });
+            }
+        }
+
+        routes.push_back({ http::Method::Get, "/" });
+        routes.push_back({ http::Method::Get, "/health" });
+        routes.push_back({ http::Method::Get, "/static/*path" });
+
+        return routes;
+    }
+
+    // Converts a route pattern into the equivalent regular expression...
+    auto to_regex(std::string const& pattern) -> std::regex {
+        auto out = std::string { "^" };
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            auto const segment_start = i > 0 && pattern[i-1] == '/';
+            if (segment_start && pattern[i] == ':') {
+                out += "([^/]+)";
+                while (i + 1 < pattern.size() && pattern[i+1] != '/') { ++i; }
+            }
+            else if (segment_start && pattern[i] == '*') {
+                out += "(.*)";
+                break;
+            }
+            else {
+                out += pattern[i];
+            }
+        }
+
+        return std::regex { out + "$", std::regex::optimize };
+    }
+
+    // Produces a concrete path that matches `pattern`...
+    auto instantiate(std::string const& pattern, std::mt19937& rng)
+        -> std::string
+    {
+        auto out = std::string { };
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            auto const segment_start = i > 0 && pattern[i-1] == '/';
+            if (segment_start && (pattern[i] == ':' || pattern[i] == '*')) {
+                out += std::to_string(rng() % 1000000);
+                while (i + 1 < pattern.size() && pattern[i+1] != '/') { ++i; }
+            }
+            else {
+                out += pattern[i];
+            }
+        }
+
+        return out;
+    }
+
+    template<typename F>
+    auto measure(char const* name,
+                 size_t iterations,
+                 std::vector<std::pair<http::Method, std::string>> const& paths,
+                 F&& f) -> void
+    {
+        using Clock = std::chrono::steady_clock;
+
+        auto matched = size_t { 0 };
+        auto const start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            auto const& p = paths[i % paths.size()];
+            matched += f(p.first, p.second) ? 1 : 0;
+        }
+        auto const elapsed = Clock::now() - start;
+
+        auto const ns = std::chrono::duration_cast<
+            std::chrono::nanoseconds>(elapsed).count();
+
+        std::cout << name << ": "
+                  << (static_cast<double>(ns) / iterations) << " ns/match, "
+                  << matched << "/" << iterations << " matched\n";
+    }
+}
+
+auto main(int argc, char** argv) -> int {
+    auto const iterations = argc > 1 
+        ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) 
+        : static_cast<size_t>(200000);
+
+    auto const routes = make_routes();
+
+    auto builder = http::RouterBuilder<size_t> { };
+    auto regexes = std::vector<RegexRoute> { };
+    for (size_t i = 0; i < routes.size(); ++i) {
+        auto r = builder.with_route(routes[i].method, routes[i].pattern, i);
+        if (!r) {
+            std::cerr << routes[i].pattern << ": " 
+                      << result::error(std::move(r)).message() << "\n";
+            return 1;
+        }
+
+        regexes.push_back({ routes[i].method, to_regex(routes[i].pattern), i });
+    }
+
+    auto const router = std::move(builder).build();
+
+    // Requests are drawn from the whole table, plus some that don't match
+    // anything...
+    auto rng = std::mt19937 { 42 };
+    auto paths = std::vector<std::pair<http::Method, std::string>> { };
+    for (size_t i = 0; i < 4096; ++i) {
+        auto const& r = routes[rng() % routes.size()];
+        paths.emplace_back(r.method, instantiate(r.pattern, rng));
+        if (i % 16 == 0) {
+            paths.emplace_back(r.method, "/api/v1/unknown/" + std::to_string(i));
+        }
+    }
+
+    std::cout << routes.size() << " routes, "
+              << paths.size() << " distinct paths\n";
+
+    auto params = http::RouteParameters { };
+    measure("radix router", iterations, paths, 
+        [&](http::Method m, std::string const& path) {
+            return router.match(m, path, params) != nullptr;
+        });
+
+    auto captures = std::smatch { };
+    measure("linear regex", iterations / 100 + 1, paths, 
+        [&](http::Method m, std::string const& path) {
+            for (auto const& r : regexes) {
+                if (r.method == m && std::regex_match(path, captures, r.expression)) {
+                    return true;
+                }
+            }
+            return false;
+        });
+
+    return 0;
+}
@@ -0,0 +1,28 @@
+#ifndef HTTP_BUFFER_HPP_INCLUDED
+#define HTTP_BUFFER_HPP_INCLUDED
+
+#include <cstddef>
+
+namespace http {
+
+    // A non-owning view of some bytes, laid out so that a sequence of
+    // them can be handed to a vectored write (e.g. `writev`, or
+    // `WSASend` after conversion)...
+    struct ConstBuffer {
+        void const* data;
+        size_t size;
+    };
+
+    // Returns the total number of bytes referred to by `[first, last)`
+    template<typename Iterator>
+    auto buffer_size(Iterator first, Iterator last) noexcept -> size_t {
+        auto total = static_cast<size_t>(0);
+        for (; first != last; ++first) {
+            total += first->size;
+        }
+
+        return total;
+    }
+}
+
+#endif //HTTP_BUFFER_HPP_INCLUDED
@@ -0,0 +1,26 @@
+#ifndef HTTP_DATE_HPP_INCLUDED
+#define HTTP_DATE_HPP_INCLUDED
+
+#include <ctime>
+#include <cstddef>
+
+namespace http {
+
+    // The length of an IMF-fixdate, as used in the `Date` header. E.g.
+    // "Sun, 06 Nov 1994 08:49:37 GMT". See RFC 7231, Section 7.1.1.1
+    constexpr size_t DATE_LENGTH = 29;
+
+    // Writes `t` as an IMF-fixdate to `out`, which must have room for
+    // `DATE_LENGTH` characters. No NUL terminator is written. This
+    // doesn't depend on the C locale, or on `gmtime`.
+    auto format_date(std::time_t t, char* out) noexcept -> void;
+
+    // Returns the current time as a NUL-terminated IMF-fixdate. The text
+    // is cached per-thread and only reformatted when the second changes,
+    // so this is cheap enough to call for every response. The pointer
+    // remains valid for the lifetime of the calling thread, but its
+    // contents change on later calls...
+    auto current_date() noexcept -> char const*;
+}
+
+#endif //HTTP_DATE_HPP_INCLUDED
@@ -0,0 +1,341 @@
+#ifndef HTTP_ENCODING_HPP_INCLUDED
+#define HTTP_ENCODING_HPP_INCLUDED
+
+#ifndef HTTP_HAS_ZLIB
+#error "http/encoding.hpp requires the library to be built with HTTP_ENABLE_ZLIB"
+#endif
+
+#include "result/result.hpp"
+#include "http/http.hpp"
+#include "http/response_writer.hpp"
+#include <memory>
+#include <ostream>
+#include <system_error>
+#include <vector>
+
+namespace http {
+
+    enum class ContentCoding {
+        Identity,
+        Gzip,
+        Deflate,
+    };
+
+    struct EncodingOptions {
+        // The zlib compression level, from 1 (fastest) to 9 (smallest)...
+        int level = 6;
+
+        // Bodies smaller than this number of bytes are sent unencoded;
+        // compressing them costs more than it saves...
+        size_t threshold = 1024;
+
+        // The size of the buffer compressed output is collected in. Each
+        // time it fills, it is written out as a single chunk...
+        size_t chunk_size = 16 * 1024;
+    };
+
+    // Chooses the coding to use for a response, based on the request's
+    // `Accept-Encoding` header. `gzip` is preferred when the client
+    // weights it the same as `deflate`...
+    auto negotiate_encoding(HttpRequest const& request) -> ContentCoding;
+
+    // How much of its pending output `Encoder::encode()` produces...
+    enum class EncodeFlush {
+        // As much as zlib chooses; it may hold some back, to compress
+        // better...
+        None,
+        // Everything for the input consumed so far, ending on a byte
+        // boundary, so that it can be decoded before the stream ends...
+        Sync,
+        // Everything, followed by the end of the stream...
+        Finish,
+    };
+
+    // A streaming compressor...
+    struct Encoder {
+        // Fails with `std::errc::not_enough_memory` if zlib can't
+        // allocate its state...
+        static auto create(ContentCoding coding, int level) noexcept
+            -> result::Result<Encoder, std::error_code>;
+
+        Encoder(Encoder&&) noexcept;
+        ~Encoder();
+
+        auto operator=(Encoder&&) noexcept -> Encoder&;
+
+        // Compresses as much of `[in, in + in_size)` as fits into
+        // `[out, out + out_size)`. `consumed` receives the number of input
+        // bytes used. Returns the number of bytes written to `out`.
+        //
+        // Once all input has been consumed, `flush` applies. With
+        // `EncodeFlush::Finish` the stream is terminated; keep calling
+        // until `is_finished()`. With `EncodeFlush::Sync`, keep calling
+        // until less than `out_size` bytes are written.
+        auto encode(uint8_t const* in,
+                    size_t in_size,
+                    size_t& consumed,
+                    uint8_t* out,
+                    size_t out_size,
+                    EncodeFlush flush)
+            -> result::Result<size_t, std::error_code>;
+
+        auto is_finished() const noexcept -> bool;
+
+    private:
+        struct State;
+
+        explicit Encoder(std::unique_ptr<State> state) noexcept;
+
+        std::unique_ptr<State> state_;
+    };
+
+    // A streaming decompressor. `ContentCoding::Deflate` accepts both
+    // zlib-wrapped and raw deflate data, because clients send both...
+    struct Decoder {
+        // Fails with `std::errc::not_enough_memory` if zlib can't
+        // allocate its state...
+        static auto create(ContentCoding coding) noexcept
+            -> result::Result<Decoder, std::error_code>;
+
+        Decoder(Decoder&&) noexcept;
+        ~Decoder();
+
+        auto operator=(Decoder&&) noexcept -> Decoder&;
+
+        // Decompresses as much of `[in, in + in_size)` as fits into
+        // `[out, out + out_size)`. `consumed` receives the number of input
+        // bytes used. Returns the number of bytes written to `out`, or
+        // `ParseError::INVALID_CONTENT_ENCODING`.
+        auto decode(uint8_t const* in,
+                    size_t in_size,
+                    size_t& consumed,
+                    uint8_t* out,
+                    size_t out_size) -> result::Result<size_t, std::error_code>;
+
+        // `true` once the end of the compressed stream has been seen...
+        auto is_finished() const noexcept -> bool;
+
+        // Gets ready to decode another stream of the same coding, such as
+        // the next member of a multi-member gzip body...
+        auto reset() noexcept -> std::error_code;
+
+    private:
+        struct State;
+
+        explicit Decoder(std::unique_ptr<State> state) noexcept;
+
+        std::unique_ptr<State> state_;
+    };
+
+    namespace detail {
+        inline auto coding_name(ContentCoding coding) noexcept -> char const* {
+            return coding == ContentCoding::Gzip ? "gzip" : "deflate";
+        }
+
+        // Adds `name` to the first `Vary` header, unless a `Vary` header
+        // already lists it (or `*`). Adds a `Vary` header if there isn't
+        // one...
+        auto add_vary(HeaderContainer& headers, char const* name) -> void;
+    }
+
+    // Writes a response whose body is compressed, chunk by chunk, as it
+    // is written. Each chunk is sent as soon as `EncodingOptions::
+    // chunk_size` bytes of compressed output are ready, or when
+    // `flush()` is called, so compression overlaps with sending rather
+    // than preceding it.
+    template<typename T, typename Traits = std::char_traits<T>>
+    struct EncodingWriter {
+        // Writes the status line and headers of `head`. Nothing is
+        // written if the compressor can't be created...
+        static auto create(std::basic_ostream<T, Traits>& os,
+                           HttpResponse const& head,
+                           ContentCoding coding,
+                           EncodingOptions const& options = 
+                               EncodingOptions { })
+            -> result::Result<EncodingWriter, std::error_code>
+        {
+            auto encoder = Encoder::create(coding, options.level);
+            if (!encoder) {
+                return result::err(result::error(std::move(encoder)));
+            }
+
+            return result::ok(EncodingWriter { 
+                os, 
+                encoded_head(head, coding), 
+                result::value(std::move(encoder)),
+                options 
+            });
+        }
+
+        auto write(void const* data, size_t size)
+            -> result::Result<EncodingWriter*, std::error_code>
+        {
+            return encode(static_cast<uint8_t const*>(data),
+                          size,
+                          EncodeFlush::None);
+        }
+
+        // Flushes the compressor, then terminates the chunked body...
+        auto finish(HeaderContainer const& trailers = HeaderContainer { })
+            -> result::Result<EncodingWriter*, std::error_code>
+        {
+            auto r = encode(nullptr, 0, EncodeFlush::Finish);
+            if (!r) {
+                return r;
+            }
+
+            write_buffer();
+            writer_.finish(trailers);
+            return result::ok(this);
+        }
+
+        // Sends everything written so far as a chunk, that can be
+        // decoded without the rest of the body, then flushes the
+        // stream. Each flush costs a few bytes of compression...
+        auto flush() -> result::Result<EncodingWriter*, std::error_code> {
+            auto r = encode(nullptr, 0, EncodeFlush::Sync);
+            if (!r) {
+                return r;
+            }
+
+            write_buffer();
+            writer_.flush();
+            return result::ok(this);
+        }
+
+    private:
+        EncodingWriter(std::basic_ostream<T, Traits>& os,
+                       HttpResponse const& head,
+                       Encoder encoder,
+                       EncodingOptions const& options) :
+            writer_ { os, head }
+        ,   encoder_ { std::move(encoder) }
+        ,   buffer_(std::max(options.chunk_size, static_cast<size_t>(64)))
+        ,   used_ { 0 }
+        { }
+
+        static auto encoded_head(HttpResponse const& head,
+                                 ContentCoding coding) -> HttpResponse
+        {
+            auto headers = head.headers();
+            headers.emplace_back("Content-Encoding",
+                                 detail::coding_name(coding));
+            detail::add_vary(headers, "Accept-Encoding");
+
+            return HttpResponseBuilder { }
+                .with_protocol({
+                    head.version(),
+                    head.status_code(),
+                    head.status_text()
+                })
+                .with_headers(std::move(headers))
+                .build();
+        }
+
+        auto encode(uint8_t const* data, size_t size, EncodeFlush flush)
+            -> result::Result<EncodingWriter*, std::error_code>
+        {
+            // A sync flush is complete once the encoder stops filling
+            // the space it is given...
+            auto flushed = false;
+            while (size ||
+                   (flush == EncodeFlush::Finish &&
+                       !encoder_.is_finished()) ||
+                   (flush == EncodeFlush::Sync && !flushed))
+            {
+                auto const room = buffer_.size() - used_;
+                auto consumed = static_cast<size_t>(0);
+                auto r = encoder_.encode(data,
+                                         size,
+                                         consumed,
+                                         buffer_.data() + used_,
+                                         room,
+                                         flush);
+                if (!r) {
+                    return result::err(result::error(std::move(r)));
+                }
+
+                auto const written = result::value(std::move(r));
+                data += consumed;
+                size -= consumed;
+                used_ += written;
+                flushed = !size && written < room;
+
+                if (used_ == buffer_.size()) {
+                    write_buffer();
+                }
+            }
+
+            return result::ok(this);
+        }
+
+        auto write_buffer() -> void {
+            if (used_) {
+                writer_.write(buffer_.data(), used_);
+                used_ = 0;
+            }
+        }
+
+        ResponseWriter<T, Traits> writer_;
+        Encoder encoder_;
+        std::vector<uint8_t> buffer_;
+        size_t used_;
+    };
+
+    // Writes `response`, compressing its body with `coding` if it is
+    // large enough and isn't already encoded. Otherwise, this is the
+    // same as `os << response`. Compression needs a chunked body, so
+    // HTTP/1.0 responses are always sent unencoded.
+    template<typename T>
+    auto write_response(std::basic_ostream<T>& os,
+                        HttpResponse const& response,
+                        ContentCoding coding,
+                        EncodingOptions const& options = EncodingOptions { })
+        -> result::Result<std::basic_ostream<T>*, std::error_code>
+    {
+        auto const& headers = response.headers();
+
+        if (coding == ContentCoding::Identity ||
+            response.version() != Version::Http11 ||
+            response.body().size() < options.threshold ||
+            find_header(headers, "Content-Encoding") != headers.end())
+        {
+            os << response;
+            return result::ok(&os);
+        }
+
+        auto w = EncodingWriter<T>::create(os, response, coding, options);
+        if (!w) {
+            return result::err(result::error(std::move(w)));
+        }
+
+        auto writer = result::value(std::move(w));
+
+        // Feed the body through in chunk-sized pieces, so that the first
+        // compressed chunk can be written before the whole body has been
+        // compressed...
+        auto const piece = std::max(options.chunk_size,
+                                    static_cast<size_t>(64));
+        auto const* p = response.body().data();
+        auto remaining = response.body().size();
+        while (remaining) {
+            auto n = std::min(remaining, piece);
+            auto r = writer.write(p, n);
+            if (!r) {
+                return result::err(result::error(std::move(r)));
+            }
+
+            p += n;
+            remaining -= n;
+        }
+
+        auto r = writer.finish();
+        if (!r) {
+            return result::err(result::error(std::move(r)));
+        }
+
+        return result::ok(&os);
+    }
+}
+
+#endif //HTTP_ENCODING_HPP_INCLUDED
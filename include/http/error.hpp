@@ -3,6 +3,8 @@
 
 #include <system_error>
 #include <string>
+#include <vector>
+#include <cstdint>
 
 namespace http {
 
@@ -39,6 +41,16 @@ namespace http {
         STRICT,
         PAUSED,
         UNKNOWN,
+
+        // The following are raised by this library rather than by
+        // http-parser. They start well above http-parser's own codes, so
+        // new versions of it can't collide with them...
+        UNSUPPORTED_CONTENT_ENCODING = 100,
+        INVALID_CONTENT_ENCODING,
+        HEADERS_TOO_LARGE,
+        TOO_MANY_HEADERS,
+        URL_TOO_LONG,
+        BODY_TOO_LARGE,
     };
 
     struct ParseErrorCategory : std::error_category {
@@ -49,5 +61,26 @@ namespace http {
     auto parse_category() -> ParseErrorCategory const&;
 
     auto make_error_code(ParseError e) -> std::error_code;
+
+    struct ParseErrorCount {
+        ParseError error;
+        uint64_t count;
+    };
+
+    // Returns how many parses have failed with `e`, across all threads,
+    // since the process started (or the counts were last reset)...
+    auto parse_error_count(ParseError e) noexcept -> uint64_t;
+
+    // Returns the count of every `ParseError` that has occurred at least
+    // once, for exporting to a metrics system...
+    auto parse_error_counts() -> std::vector<ParseErrorCount>;
+
+    auto reset_parse_error_counts() noexcept -> void;
+
+    namespace detail {
+        // Counts a failed parse. Errors from other categories (e.g. a
+        // failure to allocate a body) aren't counted...
+        auto count_parse_error(std::error_code const& ec) noexcept -> void;
+    }
 }
 #endif //HTTP_ERROR_HPP_INCLUDED
@@ -0,0 +1,84 @@
+#ifndef HTTP_FORWARD_HPP_INCLUDED
+#define HTTP_FORWARD_HPP_INCLUDED
+
+#include "http/http.hpp"
+#include "http/buffer.hpp"
+#include <string>
+#include <vector>
+
+namespace http {
+
+    namespace detail {
+        struct Forwarder;
+    }
+
+    struct ForwardOptions {
+        // The address of the client, appended to `X-Forwarded-For` when
+        // forwarding a request. Any existing `X-Forwarded-For` headers
+        // are combined into one. Leave it empty to forward them as they
+        // are. Ignored for responses...
+        std::string forwarded_for;
+
+        // Headers to remove, in addition to the hop-by-hop ones...
+        std::vector<std::string> remove;
+
+        // Headers to add after the remaining ones...
+        HeaderContainer add;
+    };
+
+    // A message ready to be forwarded, as a sequence of buffers suitable
+    // for a vectored write. Most of the buffers refer to the original
+    // input, which must outlive this object; only the headers that were
+    // added are stored here.
+    struct ForwardedMessage {
+        ForwardedMessage(ForwardedMessage const&) = delete;
+        ForwardedMessage(ForwardedMessage&&) = default;
+
+        auto operator=(ForwardedMessage const&) -> ForwardedMessage& = delete;
+        auto operator=(ForwardedMessage&&) -> ForwardedMessage& = default;
+
+        inline auto buffers() const noexcept -> std::vector<ConstBuffer> const&
+        { return buffers_; }
+
+        // The total number of bytes in `buffers()`...
+        inline auto size() const noexcept -> size_t
+        { return buffer_size(buffers_.begin(), buffers_.end()); }
+
+    private:
+        friend struct detail::Forwarder;
+
+        ForwardedMessage() = default;
+
+        std::vector<ConstBuffer> buffers_;
+        std::vector<char> storage_;
+    };
+
+    // Prepares `request` to be forwarded upstream. `data` and `size` are
+    // the bytes it was parsed from, as reported by `parse_request()`.
+    // Hop-by-hop headers (`Connection`, `Keep-Alive`, `Proxy-*`, `TE`,
+    // `Upgrade` and any named by `Connection`) are removed, and the edits
+    // in `options` are applied. Everything else, including the body and
+    // its framing, is forwarded byte-for-byte from `data`.
+    //
+    // So `data` must still hold the message exactly as it was received.
+    // That rules out `parse_request_in_place()` and
+    // `parse_response_in_place()`, which may compact a chunked body over
+    // its framing, and
+    // `ParseOptions::decode_content_encoding`, after which the body and
+    // headers of `request` no longer match `data`. Debug builds assert
+    // that the body isn't a view into `data`.
+    auto forward_request(char const* data,
+                         size_t size,
+                         HttpRequest const& request,
+                         ForwardOptions const& options = ForwardOptions { })
+        -> ForwardedMessage;
+
+    // As above, for a response being returned downstream...
+    auto forward_response(char const* data,
+                          size_t size,
+                          HttpResponse const& response,
+                          ForwardOptions const& options = ForwardOptions { })
+        -> ForwardedMessage;
+}
+
+#endif //HTTP_FORWARD_HPP_INCLUDED
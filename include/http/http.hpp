@@ -3,13 +3,18 @@
 
 #include "result/result.hpp"
 #include "http/error.hpp"
+#include "http/mapped_file.hpp"
+#include "http/url.hpp"
 #include <vector>
 #include <tuple>
 #include <string>
 #include <algorithm>
 #include <type_traits>
 #include <iterator>
+#include <cctype>
 #include <ostream>
+#include <limits>
+#include <memory>
 
 #include <cassert>
 
@@ -87,6 +92,143 @@ namespace http {
     using HeaderContainer = std::vector<Header>;
     using BodyContainer = std::vector<uint8_t>;
 
+    // The body of a request or response. The bytes are held either in a
+    // `BodyContainer` or, for large payloads, in a `MappedFile`. Copies
+    // of a mapped body share the same (read-only) mapping. A body can
+    // also be a view of bytes owned by someone else (see
+    // `parse_request_in_place()`)...
+    struct Body {
+        Body() = default;
+
+        Body(BodyContainer bytes) noexcept
+            :   bytes_ { std::move(bytes) }
+        { }
+
+        Body(MappedFile file)
+            :   file_ { std::make_shared<MappedFile const>(std::move(file)) }
+        { }
+
+        // A body that refers to `[data, data + size)` without copying it.
+        // The bytes must outlive the body, and every copy of it...
+        static auto view(uint8_t const* data, size_t size) noexcept -> Body {
+            auto body = Body { };
+            body.view_ = data;
+            body.view_size_ = size;
+            return body;
+        }
+
+        inline auto is_mapped() const noexcept -> bool
+        { return file_ && file_->is_mapped(); }
+
+        inline auto is_view() const noexcept -> bool
+        { return view_ != nullptr; }
+
+        inline auto data() const noexcept -> uint8_t const*
+        {
+            return is_view() ? view_ 
+                 : is_mapped() ? file_->data() 
+                 : bytes_.data();
+        }
+
+        inline auto size() const noexcept -> size_t
+        {
+            return is_view() ? view_size_ 
+                 : is_mapped() ? file_->size() 
+                 : bytes_.size();
+        }
+
+        inline auto empty() const noexcept -> bool
+        { return size() == 0; }
+
+        inline auto begin() const noexcept -> uint8_t const*
+        { return data(); }
+
+        inline auto end() const noexcept -> uint8_t const*
+        { return data() + size(); }
+
+    private:
+        BodyContainer bytes_;
+        std::shared_ptr<MappedFile const> file_;
+        uint8_t const* view_ = nullptr;
+        size_t view_size_ = 0;
+    };
+
+    // Describes where, and in what state, a parse failed. It is only
+    // filled in when parsing fails, so successful parses don't pay for
+    // it...
+    struct ParseDiagnostics {
+        std::error_code error;
+
+        // The offset of the byte the parser stopped at. This is the size
+        // of the input if it ended too soon...
+        size_t offset = 0;
+
+        // The 1-based line and column of `offset`...
+        size_t line = 0;
+        size_t column = 0;
+
+        // The part of the message the parser was in: "start-line",
+        // "headers" or "body"...
+        char const* phase = "";
+
+        // The byte at `offset`, or `-1` if it is past the end of the
+        // input...
+        int byte = -1;
+
+        // Up to `EXCERPT_CONTEXT` bytes either side of `offset`, with
+        // unprintable bytes escaped, C-style...
+        std::string excerpt;
+
+        static constexpr size_t EXCERPT_CONTEXT = 16;
+    };
+
+    struct ParseOptions {
+        // Bodies larger than this number of bytes are copied into an
+        // anonymous, memory-mapped temporary file instead of a
+        // `BodyContainer`, so they don't count towards resident memory.
+        // Decoded bodies (see `decode_content_encoding`) are written to
+        // the file as soon as they cross the threshold. POSIX only; on
+        // other systems, setting it fails every parse with
+        // `std::errc::not_supported`...
+        size_t body_spill_threshold = std::numeric_limits<size_t>::max();
+
+        // Inflate bodies sent with `Content-Encoding: gzip` or `deflate`
+        // while they are parsed. The decoded message has no
+        // `Content-Encoding` header, and its `Content-Length` (if any)
+        // matches the decoded body. Requires the library to be built with
+        // `HTTP_ENABLE_ZLIB`; otherwise, encoded bodies are rejected with
+        // `ParseError::UNSUPPORTED_CONTENT_ENCODING`. Applies whenever the
+        // body is captured (see `Capture`), whether or not the headers
+        // are...
+        bool decode_content_encoding = false;
+
+        // The following limits bound the memory a single message can make
+        // the parser use. They are checked as the message is parsed, which
+        // stops as soon as one is exceeded...
+
+        // The total size of all header names and values, in bytes. Exceeding
+        // it fails with `ParseError::HEADERS_TOO_LARGE`. The default is
+        // http-parser's own limit on the size of the header section, so
+        // it never rejects a message the parser accepts...
+        size_t max_header_bytes = 80 * 1024;
+
+        // The number of headers. Exceeding it fails with
+        // `ParseError::TOO_MANY_HEADERS`. Unlimited by default...
+        size_t max_header_count = std::numeric_limits<size_t>::max();
+
+        // The length of the request-target. Exceeding it fails with
+        // `ParseError::URL_TOO_LONG`. Unlimited by default...
+        size_t max_url_length = std::numeric_limits<size_t>::max();
+
+        // The size of the body, in bytes. When decoding a
+        // `Content-Encoding`, this applies to both the encoded and decoded
+        // body. Exceeding it fails with `ParseError::BODY_TOO_LARGE`...
+        size_t max_body_size = std::numeric_limits<size_t>::max();
+
+        // If not `nullptr`, filled in when parsing fails...
+        ParseDiagnostics* diagnostics = nullptr;
+    };
+
     struct HttpRequestProtocolHeader {
         Method method;
         std::string path;
@@ -99,6 +241,23 @@ namespace http {
         std::string status_text;
     };
 
+    namespace detail {
+        // Replaces every header called `name` with a single header that has
+        // `value`, keeping the position of the first. Appends the header if
+        // there are none...
+        auto set_header(HeaderContainer& headers,
+                        char const* name,
+                        std::string value) -> void;
+
+        // Removes every header called `name`. Returns how many there were...
+        auto remove_header(HeaderContainer& headers, 
+                           char const* name) noexcept -> size_t;
+
+        // Updates an existing `Content-Length` header to `size`...
+        auto update_content_length(HeaderContainer& headers, 
+                                   size_t size) -> void;
+    }
+
     struct HttpRequest {
         friend struct HttpRequestHeaderBuilder;
 
@@ -111,20 +270,59 @@ namespace http {
         inline auto version() const -> Version 
         { return protocol_.version; }
 
+        // Splits `path()` into its components. The result refers to this
+        // request, so it mustn't outlive it...
+        inline auto target() const noexcept 
+            -> result::Result<RequestTarget, std::error_code>
+        { return parse_target(protocol_.path, method() == Method::Connect); }
+
         inline auto headers() const -> HeaderContainer const& 
         { return headers_; }
 
-        inline auto body() const -> BodyContainer const&
+        inline auto body() const -> Body const&
         { return body_; }
 
+        // `true` if the request asks to switch protocols (with `Upgrade`,
+        // or `CONNECT`). When parsed, the bytes that follow the request
+        // belong to the new protocol, not to another HTTP request...
+        inline auto is_upgrade() const noexcept -> bool
+        { return upgrade_; }
+
+        // Moves the headers out of the request, without copying them...
+        inline auto take_headers() && -> HeaderContainer
+        { return std::move(headers_); }
+
+        // Moves the body out of the request, without copying it...
+        inline auto take_body() && -> Body
+        { return std::move(body_); }
+
+        inline auto set_path(std::string path) -> void
+        { protocol_.path = std::move(path); }
+
+        // Header names are compared case-insensitively. See
+        // `detail::set_header()` and `detail::remove_header()`...
+        inline auto set_header(char const* name, std::string value) -> void
+        { detail::set_header(headers_, name, std::move(value)); }
+
+        inline auto remove_header(char const* name) noexcept -> size_t
+        { return detail::remove_header(headers_, name); }
+
+        // Replaces the body. If there is a `Content-Length` header, it is
+        // updated to match...
+        inline auto set_body(Body body) -> void {
+            detail::update_content_length(headers_, body.size());
+            body_ = std::move(body);
+        }
+
     private:
         HttpRequest(HttpRequestProtocolHeader, 
                     HeaderContainer,
-                    BodyContainer);
+                    Body);
 
         HttpRequestProtocolHeader protocol_;
         HeaderContainer headers_;
-        BodyContainer body_;
+        Body body_;
+        bool upgrade_ = false;
     };
 
     struct HttpResponse {
@@ -142,19 +340,183 @@ namespace http {
         inline auto headers() const -> HeaderContainer const&
         { return headers_; }
 
-        inline auto body() const -> BodyContainer const&
+        inline auto body() const -> Body const&
         { return body_; }
 
+        // `true` if the response switches protocols (e.g. `101 Switching
+        // Protocols`). When parsed, the bytes that follow the response
+        // belong to the new protocol...
+        inline auto is_upgrade() const noexcept -> bool
+        { return upgrade_; }
+
+        // Moves the headers out of the response, without copying them...
+        inline auto take_headers() && -> HeaderContainer
+        { return std::move(headers_); }
+
+        // Moves the body out of the response, without copying it...
+        inline auto take_body() && -> Body
+        { return std::move(body_); }
+
+        // Header names are compared case-insensitively. See
+        // `detail::set_header()` and `detail::remove_header()`...
+        inline auto set_header(char const* name, std::string value) -> void
+        { detail::set_header(headers_, name, std::move(value)); }
+
+        inline auto remove_header(char const* name) noexcept -> size_t
+        { return detail::remove_header(headers_, name); }
+
+        // Replaces the body. If there is a `Content-Length` header, it is
+        // updated to match...
+        inline auto set_body(Body body) -> void {
+            detail::update_content_length(headers_, body.size());
+            body_ = std::move(body);
+        }
+
     private:
         HttpResponse(HttpResponseProtocolHeader, 
                      HeaderContainer,
-                     BodyContainer);
+                     Body);
 
         HttpResponseProtocolHeader protocol_;
         HeaderContainer headers_;
-        BodyContainer body_;
+        Body body_;
+        bool upgrade_ = false;
     };
 
+    namespace detail {
+        inline auto iequals(char const* first1, 
+                            char const* last1,
+                            char const* first2,
+                            char const* last2) noexcept -> bool
+        {
+            if ((last1 - first1) != (last2 - first2)) {
+                return false;
+            }
+
+            return std::equal(first1, last1, first2, [](char a, char b) {
+                return std::tolower(static_cast<unsigned char>(a)) ==
+                       std::tolower(static_cast<unsigned char>(b));
+            });
+        }
+
+        inline auto iequals(std::string const& lhs, 
+                            char const* rhs) noexcept -> bool
+        {
+            return iequals(lhs.data(), 
+                           lhs.data() + lhs.size(),
+                           rhs,
+                           rhs + std::char_traits<char>::length(rhs));
+        }
+
+        // Enough room for every decimal digit of a 64-bit `size_t`...
+        constexpr size_t DECIMAL_MAX = 20;
+
+        // Formats `value` as decimal digits, right-aligned in `buffer`.
+        // Returns a pointer to the first digit; the digits always end at
+        // the end of `buffer`.
+        inline auto format_decimal(size_t value, 
+                                   char (&buffer)[DECIMAL_MAX]) noexcept 
+            -> char*
+        {
+            static_assert(sizeof(size_t) <= 8, 
+                          "DECIMAL_MAX is too small for size_t");
+
+            auto* p = std::end(buffer);
+            do {
+                *--p = static_cast<char>('0' + (value % 10));
+                value /= 10;
+            } while (value);
+
+            return p;
+        }
+
+        template<typename T, typename Traits>
+        auto write_status_line(std::basic_ostream<T, Traits>& os, 
+                               HttpResponse const& response) 
+            -> std::basic_ostream<T, Traits>&
+        {
+            constexpr char NL[] = "\r\n";
+
+            os << response.version() << " ";
+
+            char sc[DECIMAL_MAX];
+            auto const* first = format_decimal(response.status_code(), sc);
+
+            os.write(
+                reinterpret_cast<T const*>(first),
+                std::end(sc) - first);
+
+            os << " ";
+
+            os.write(
+                reinterpret_cast<T const*>(
+                    std::addressof(*response.status_text().begin())),
+                 response.status_text().size());
+
+            return os.write(
+                reinterpret_cast<T const*>(
+                    std::addressof(*std::begin(NL))),
+                std::distance(std::begin(NL), std::end(NL)-1));
+        }
+    }
+
+    namespace detail {
+        inline auto method_name(Method method) noexcept -> char const* {
+            constexpr char const* NAMES[] = {
+                "DELETE",
+                "GET",
+                "HEAD",
+                "POST",
+                "PUT",
+                "CONNECT",
+                "OPTIONS",
+                "TRACE",
+            };
+
+            return NAMES[static_cast<size_t>(method)];
+        }
+
+        template<typename T, typename Traits>
+        auto write_request_line(std::basic_ostream<T, Traits>& os, 
+                                HttpRequest const& request) 
+            -> std::basic_ostream<T, Traits>&
+        {
+            constexpr char NL[] = "\r\n";
+
+            auto const* method = method_name(request.method());
+            os.write(
+                reinterpret_cast<T const*>(method),
+                std::char_traits<char>::length(method));
+
+            os << " ";
+
+            os.write(
+                reinterpret_cast<T const*>(request.path().data()),
+                request.path().size());
+
+            os << " " << request.version();
+
+            return os.write(
+                reinterpret_cast<T const*>(
+                    std::addressof(*std::begin(NL))),
+                std::distance(std::begin(NL), std::end(NL)-1));
+        }
+    }
+
+    // Finds the first header called `name`. Header names are compared
+    // case-insensitively...
+    inline auto find_header(HeaderContainer const& headers, 
+                            char const* name) noexcept 
+        -> HeaderContainer::const_iterator
+    {
+        return std::find_if(
+            headers.begin(),
+            headers.end(),
+            [&](auto const& h) {
+                return detail::iequals(std::get<0>(h), name);
+            });
+    }
+
     template<typename T>
     auto operator<<(std::basic_ostream<T>& os, 
                     HttpResponse const& response) 
@@ -162,28 +524,33 @@ namespace http {
     {
         constexpr char NL[] = "\r\n";
 
-        os << response.version() << " ";
+        detail::write_status_line(os, response);
 
-        auto sc = std::to_string(response.status_code());
+        for (auto const& h : response.headers()) {
+            os << h << "\r\n";
+        }
 
         os.write(
             reinterpret_cast<T const*>(
-                std::addressof(*sc.begin())),
-            sc.size());
-
-        os << " ";
+                std::addressof(*std::begin(NL))),
+            std::distance(std::begin(NL), std::end(NL)-1));
 
         os.write(
-            reinterpret_cast<T const*>(
-                std::addressof(*response.status_text().begin())),
-             response.status_text().size());
+            reinterpret_cast<T const*>(response.body().data()),
+            response.body().size());
+        return os;
+    }
 
-        os.write(
-            reinterpret_cast<T const*>(
-                std::addressof(*std::begin(NL))),
-            std::distance(std::begin(NL), std::end(NL)-1));
+    template<typename T>
+    auto operator<<(std::basic_ostream<T>& os, 
+                    HttpRequest const& request) 
+        -> std::basic_ostream<T>&
+    {
+        constexpr char NL[] = "\r\n";
 
-        for (auto const& h : response.headers()) {
+        detail::write_request_line(os, request);
+
+        for (auto const& h : request.headers()) {
             os << h << "\r\n";
         }
 
@@ -193,9 +560,8 @@ namespace http {
             std::distance(std::begin(NL), std::end(NL)-1));
 
         os.write(
-            reinterpret_cast<T const*>(
-                std::addressof(*response.body().begin())),
-             response.body().size());
+            reinterpret_cast<T const*>(request.body().data()),
+            request.body().size());
         return os;
     }
 
@@ -211,8 +577,14 @@ namespace http {
             return std::move(*this);
         }
 
+        // Marks the message as switching protocols. See `is_upgrade()`...
+        auto with_upgrade(bool upgrade = true) && {
+            upgrade_ = upgrade;
+            return std::move(*this);
+        }
+
         auto build() && -> HttpRequest;
-        auto build(BodyContainer) && -> HttpRequest;
+        auto build(Body) && -> HttpRequest;
 
         template<typename InputIterator>
         auto build(InputIterator first, InputIterator last) &&
@@ -224,6 +596,7 @@ namespace http {
     private:
         HttpRequestProtocolHeader proto_;
         HeaderContainer headers_;    
+        bool upgrade_ = false;
     };
 
     struct HttpResponseHeaderBuilder {
@@ -238,8 +611,17 @@ namespace http {
             return std::move(*this);
         }
 
+        // Marks the message as switching protocols. See `is_upgrade()`...
+        auto with_upgrade(bool upgrade = true) && {
+            upgrade_ = upgrade;
+            return std::move(*this);
+        }
+
+        // Adds a `Date` header containing the current time...
+        auto with_date() && -> HttpResponseHeaderBuilder&&;
+
         auto build() && -> HttpResponse;
-        auto build(BodyContainer) && -> HttpResponse;
+        auto build(Body) && -> HttpResponse;
 
         template<typename InputIterator>
         auto build(InputIterator first, InputIterator last) &&
@@ -251,6 +633,7 @@ namespace http {
     private:
         HttpResponseProtocolHeader proto_;
         HeaderContainer headers_;    
+        bool upgrade_ = false;
     };
 
     struct HttpRequestBuilder {
@@ -263,29 +646,132 @@ namespace http {
             -> HttpResponseHeaderBuilder;
     };
 
+    // The parts of a request `parse_request()` collects. Parts that
+    // aren't captured are left empty in the parsed request, and the
+    // parser doesn't store or copy them; the limits in `ParseOptions`
+    // still apply to them, though. The method, version and `is_upgrade()`
+    // are always available. `ParseOptions::decode_content_encoding` still
+    // decodes a captured body when the headers aren't captured, reading
+    // `Content-Encoding` as it goes by...
+    enum class Capture : unsigned {
+        None = 0,
+        Path = 1 << 0,
+        Headers = 1 << 1,
+        Body = 1 << 2,
+        All = Path | Headers | Body,
+    };
+
+    constexpr auto operator|(Capture lhs, Capture rhs) noexcept -> Capture {
+        return static_cast<Capture>(
+            static_cast<unsigned>(lhs) | static_cast<unsigned>(rhs));
+    }
+
+    constexpr auto operator&(Capture lhs, Capture rhs) noexcept -> Capture {
+        return static_cast<Capture>(
+            static_cast<unsigned>(lhs) & static_cast<unsigned>(rhs));
+    }
+
     namespace detail {
-        auto parse_request(char const* data, size_t size) noexcept
+        constexpr auto captures(Capture set, Capture part) noexcept -> bool {
+            return (set & part) == part;
+        }
+
+        // Instantiated for every combination of `Capture` values...
+        template<Capture C>
+        auto parse_request(char const* data, 
+                           size_t size,
+                           ParseOptions const& options) noexcept
+            -> ParseResult<std::pair<HttpRequest, size_t>>;
+
+        auto parse_response(char const* data, 
+                            size_t size,
+                            ParseOptions const& options) noexcept
+            -> ParseResult<std::pair<HttpResponse, size_t>>;
+
+        auto parse_request_in_place(char* data, 
+                                    size_t size,
+                                    ParseOptions const& options) noexcept
             -> ParseResult<std::pair<HttpRequest, size_t>>;
 
-        auto parse_response(char const* data, size_t size) noexcept
+        auto parse_response_in_place(char* data, 
+                                     size_t size,
+                                     ParseOptions const& options) noexcept
             -> ParseResult<std::pair<HttpResponse, size_t>>;
     }
 
+    // Parses a request from `[first, last)`. `C` selects the parts that
+    // are collected, at compile time, so that e.g. a router can use
+    // `parse_request<Capture::Path>()` and pay nothing for the headers
+    // and body...
     template<
+        Capture C = Capture::All,
         typename Iterator,
         typename std::enable_if<
             std::is_convertible<
                 typename std::iterator_traits<Iterator>::iterator_category,
                 std::random_access_iterator_tag>::value
         >::type* = nullptr>
-    auto parse_request(Iterator first, Iterator last) noexcept
+    auto parse_request(Iterator first, 
+                       Iterator last,
+                       ParseOptions const& options = ParseOptions { }) noexcept
         -> ParseResult<std::pair<HttpRequest, size_t>> 
     {
-        return detail::parse_request(
+        return detail::parse_request<C>(
             reinterpret_cast<char const*>(std::addressof(*first)),
-            std::distance(first, last));
+            std::distance(first, last),
+            options);
+    }
+
+    // Like `parse_request()`, but the body isn't copied: the parsed
+    // request's body is a view (see `Body::view()`) into `[first, last)`,
+    // which must outlive it. A chunked body is de-chunked in place, by
+    // moving the chunks' payloads together over the chunk delimiters, so
+    // the bytes between the start of the body and the end of the last
+    // chunk are overwritten. A decoded `Content-Encoding` still produces
+    // a body of its own, and `ParseOptions::body_spill_threshold` is
+    // ignored, as the body takes no memory...
+    template<
+        typename Iterator,
+        typename std::enable_if<
+            std::is_convertible<
+                typename std::iterator_traits<Iterator>::iterator_category,
+                std::random_access_iterator_tag>::value
+        >::type* = nullptr>
+    auto parse_request_in_place(Iterator first, 
+                                Iterator last,
+                                ParseOptions const& options = ParseOptions { }
+                                ) noexcept
+        -> ParseResult<std::pair<HttpRequest, size_t>> 
+    {
+        return detail::parse_request_in_place(
+            reinterpret_cast<char*>(std::addressof(*first)),
+            std::distance(first, last),
+            options);
     }
 
+    // One connection's buffered input, for `parse_requests()`...
+    struct ParseJob {
+        char const* data;
+        size_t size;
+
+        // Not used by the parser; it lets the caller identify the
+        // connection the job came from...
+        void* context;
+    };
+
+    // Parses one request from each of the `count` jobs, appending a result
+    // for each to `results`, in the same order. This is equivalent to
+    // calling `parse_request()` for each job, but parsing a whole batch in
+    // one loop keeps the parser's code and state warm, and the buffers of
+    // upcoming jobs are prefetched while the current one is parsed. Reuse
+    // `results` between batches to avoid reallocating it.
+    auto parse_requests(ParseJob const* jobs,
+                        size_t count,
+                        std::vector<ParseResult<
+                            std::pair<HttpRequest, size_t>>>& results,
+                        ParseOptions const& options = ParseOptions { }) 
+        -> void;
+
     template<
         typename Iterator,
         typename std::enable_if<
@@ -293,12 +779,35 @@ namespace http {
                 typename std::iterator_traits<Iterator>::iterator_category,
                 std::random_access_iterator_tag>::value
         >::type* = nullptr>
-    auto parse_response(Iterator first, Iterator last) noexcept
+    auto parse_response(Iterator first, 
+                        Iterator last,
+                        ParseOptions const& options = ParseOptions { }) noexcept
         -> ParseResult<std::pair<HttpResponse, size_t>> 
     {
         return detail::parse_response(
             reinterpret_cast<char const*>(std::addressof(*first)),
-            std::distance(first, last));
+            std::distance(first, last),
+            options);
+    }
+
+    // The response equivalent of `parse_request_in_place()`...
+    template<
+        typename Iterator,
+        typename std::enable_if<
+            std::is_convertible<
+                typename std::iterator_traits<Iterator>::iterator_category,
+                std::random_access_iterator_tag>::value
+        >::type* = nullptr>
+    auto parse_response_in_place(Iterator first, 
+                                 Iterator last,
+                                 ParseOptions const& options = ParseOptions { }
+                                 ) noexcept
+        -> ParseResult<std::pair<HttpResponse, size_t>> 
+    {
+        return detail::parse_response_in_place(
+            reinterpret_cast<char*>(std::addressof(*first)),
+            std::distance(first, last),
+            options);
     }
 }
 
@@ -0,0 +1,102 @@
+#ifndef HTTP_MAPPED_FILE_HPP_INCLUDED
+#define HTTP_MAPPED_FILE_HPP_INCLUDED
+
+#include "result/result.hpp"
+#include <system_error>
+#include <cstddef>
+#include <cstdint>
+
+namespace http {
+
+    // A move-only, memory-mapped region of a file. How writes through
+    // `data()` behave depends on where the mapping came from; see `open()`
+    // and `create_temporary()`.
+    //
+    // Mapping is only implemented for POSIX systems. Elsewhere (i.e.
+    // Windows), everything here fails with `std::errc::not_supported`.
+    struct MappedFile {
+        MappedFile() noexcept;
+        MappedFile(MappedFile&&) noexcept;
+        MappedFile(MappedFile const&) = delete;
+        ~MappedFile();
+
+        auto operator=(MappedFile&&) noexcept -> MappedFile&;
+        auto operator=(MappedFile const&) -> MappedFile& = delete;
+
+        // Maps the entire contents of the file at `path`. The mapping is
+        // private to the process (copy-on-write), so writing through
+        // `data()` never modifies the file...
+        static auto open(char const* path) noexcept
+            -> result::Result<MappedFile, std::error_code>;
+
+        // Maps `size` bytes of a new, anonymous temporary file. The file
+        // is unlinked immediately, so it is reclaimed when the mapping is
+        // destroyed. The mapping is shared, so its pages are backed by the
+        // file rather than by swap; nothing else can open the file, so
+        // nothing else sees the writes...
+        static auto create_temporary(size_t size) noexcept
+            -> result::Result<MappedFile, std::error_code>;
+
+        inline auto data() noexcept -> uint8_t*
+        { return data_; }
+
+        inline auto data() const noexcept -> uint8_t const*
+        { return data_; }
+
+        inline auto size() const noexcept -> size_t
+        { return size_; }
+
+        inline auto is_mapped() const noexcept -> bool
+        { return data_ != nullptr; }
+
+    private:
+        friend struct TemporaryFile;
+
+        MappedFile(uint8_t* data, size_t size) noexcept;
+
+        uint8_t* data_;
+        size_t size_;
+    };
+
+    // An anonymous temporary file, for data whose size isn't known up
+    // front. It is filled in with `write()`, then mapped with `map()`.
+    // Like `MappedFile::create_temporary()`, the file is unlinked as soon
+    // as it is created...
+    struct TemporaryFile {
+        TemporaryFile() noexcept;
+        TemporaryFile(TemporaryFile&&) noexcept;
+        TemporaryFile(TemporaryFile const&) = delete;
+        ~TemporaryFile();
+
+        auto operator=(TemporaryFile&&) noexcept -> TemporaryFile&;
+        auto operator=(TemporaryFile const&) -> TemporaryFile& = delete;
+
+        static auto create() noexcept
+            -> result::Result<TemporaryFile, std::error_code>;
+
+        // Appends `size` bytes to the file...
+        auto write(void const* data, size_t size) noexcept 
+            -> std::error_code;
+
+        // Maps everything written so far, and closes the file; the
+        // mapping keeps its storage alive. As with `create_temporary()`,
+        // the mapping is a shared mapping of the unlinked file...
+        auto map() && noexcept -> result::Result<MappedFile, std::error_code>;
+
+        inline auto size() const noexcept -> size_t
+        { return size_; }
+
+        inline auto is_open() const noexcept -> bool
+        { return fd_ >= 0; }
+
+    private:
+        explicit TemporaryFile(int fd) noexcept;
+
+        auto close() noexcept -> void;
+
+        int fd_;
+        size_t size_;
+    };
+}
+
+#endif //HTTP_MAPPED_FILE_HPP_INCLUDED
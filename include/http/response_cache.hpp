@@ -0,0 +1,94 @@
+#ifndef HTTP_RESPONSE_CACHE_HPP_INCLUDED
+#define HTTP_RESPONSE_CACHE_HPP_INCLUDED
+
+#include "http/http.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace http {
+
+    struct ResponseCacheOptions {
+        // The total number of bytes the cache may hold, across all
+        // shards. This includes the keys and the serialized responses...
+        size_t max_bytes = 64 * 1024 * 1024;
+
+        // The number of independently locked partitions. Each gets an
+        // equal share of `max_bytes`...
+        size_t shards = 16;
+
+        // The maximum number of `Vary` variants kept for a single
+        // method + path...
+        size_t max_variants = 8;
+    };
+
+    enum class CacheStatus {
+        Miss,
+        Hit,
+        NotModified,
+    };
+
+    struct CacheLookup {
+        CacheStatus status;
+
+        // The serialized response to send. This is the full, cached
+        // response for `CacheStatus::Hit`, a "304 Not Modified" response
+        // for `CacheStatus::NotModified`, or null on a `CacheStatus::Miss`.
+        // Either response has a current `Date`, and an `Age`: the `Age`
+        // the response arrived with, plus the seconds since it was stored
+        std::shared_ptr<std::string const> bytes;
+    };
+
+    // An in-memory cache of serialized responses, keyed on the method and
+    // path of a request plus the values of any request headers listed in
+    // the response's `Vary` header. Entries are evicted in least-recently
+    // used order once the cache exceeds its byte budget.
+    //
+    // Only `GET` requests and "200 OK" responses with an explicit
+    // `max-age` (or `s-maxage`) are cached. Responses marked `no-store`,
+    // `no-cache` or `private`, or responses to requests that carry
+    // `Authorization`, are never stored. A response's `Age` counts against
+    // its `max-age`, so one that arrives already stale isn't stored.
+    // Conditional requests are answered from the cache using
+    // `If-None-Match` (weak comparison), or an exact match of
+    // `If-Modified-Since` against `Last-Modified`.
+    //
+    // A response's body is stored with a `Content-Length`, even if it was
+    // received chunked. Responses with any other transfer-coding are not
+    // stored.
+    //
+    // All member functions are safe to call concurrently.
+    struct ResponseCache {
+        using Clock = std::chrono::steady_clock;
+
+        explicit ResponseCache(ResponseCacheOptions options =
+                                   ResponseCacheOptions { });
+        ~ResponseCache();
+
+        ResponseCache(ResponseCache const&) = delete;
+        auto operator=(ResponseCache const&) -> ResponseCache& = delete;
+
+        auto lookup(HttpRequest const& request,
+                    Clock::time_point now = Clock::now()) -> CacheLookup;
+
+        // Stores `response` as the answer to `request`, if it is
+        // cacheable. Returns `true` if it was stored...
+        auto store(HttpRequest const& request,
+                   HttpResponse const& response,
+                   Clock::time_point now = Clock::now()) -> bool;
+
+        auto size_bytes() const -> size_t;
+        auto clear() -> void;
+
+    private:
+        struct Shard;
+
+        auto shard_for(std::string const& key) const -> Shard&;
+
+        ResponseCacheOptions options_;
+        std::vector<std::unique_ptr<Shard>> shards_;
+    };
+}
+
+#endif //HTTP_RESPONSE_CACHE_HPP_INCLUDED
@@ -0,0 +1,83 @@
+#ifndef HTTP_RESPONSE_TEMPLATE_HPP_INCLUDED
+#define HTTP_RESPONSE_TEMPLATE_HPP_INCLUDED
+
+#include "http/http.hpp"
+#include "http/buffer.hpp"
+#include "http/date.hpp"
+#include <array>
+#include <string>
+
+namespace http {
+
+    // A response head that is rendered once, up front, leaving slots for
+    // the fields that change with each response: `Content-Length` and,
+    // optionally, `Date`. Producing a response is then a copy of the
+    // pre-rendered bytes with those fields written in place.
+    //
+    // Any `Content-Length` or `Date` headers given to the template are
+    // replaced by its own slots. Its body is ignored.
+    struct ResponseTemplate {
+        // The number of buffers returned by `gather()`
+        static constexpr size_t GATHER_COUNT = 6;
+
+        // Storage for the variable fields of a single response, when
+        // using `gather()`. It must outlive the write...
+        struct Fields {
+            char content_length[detail::DECIMAL_MAX];
+        };
+
+        explicit ResponseTemplate(HttpResponse const& head,
+                                  bool with_date = true);
+
+        explicit ResponseTemplate(HttpResponseHeaderBuilder&& builder,
+                                  bool with_date = true);
+
+        // The largest number of bytes `render_head()` can write...
+        inline auto max_head_size() const noexcept -> size_t
+        { return prefix_.size() + detail::DECIMAL_MAX + suffix_.size(); }
+
+        inline auto has_date() const noexcept -> bool
+        { return has_date_; }
+
+        // Writes the response head into `out`, which must have room for
+        // at least `max_head_size()` bytes. `date` must point to
+        // `DATE_LENGTH` characters, and is ignored if the template has no
+        // `Date` slot. Returns the number of bytes written.
+        auto render_head(char* out,
+                         size_t content_length,
+                         char const* date) const noexcept -> size_t;
+
+        // As above, using the current date...
+        inline auto render_head(char* out, 
+                                size_t content_length) const noexcept
+            -> size_t
+        { return render_head(out, content_length, current_date()); }
+
+        // Returns the response as a sequence of buffers suitable for a
+        // vectored write. The buffers refer to this template, `fields`,
+        // `date` and `body`, so nothing is copied. Unused slots are
+        // zero-length...
+        auto gather(Fields& fields,
+                    char const* date,
+                    void const* body,
+                    size_t body_size) const noexcept
+            -> std::array<ConstBuffer, GATHER_COUNT>;
+
+        // As above, using the current date. The date buffer belongs to
+        // the calling thread, so the write must be issued from the same
+        // thread before it next asks for the current date...
+        inline auto gather(Fields& fields,
+                           void const* body,
+                           size_t body_size) const noexcept
+            -> std::array<ConstBuffer, GATHER_COUNT>
+        { return gather(fields, current_date(), body, body_size); }
+
+    private:
+        std::string prefix_;
+        std::string suffix_;
+        size_t date_offset_;
+        bool has_date_;
+    };
+}
+
+#endif //HTTP_RESPONSE_TEMPLATE_HPP_INCLUDED
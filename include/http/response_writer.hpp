@@ -0,0 +1,174 @@
+#ifndef HTTP_RESPONSE_WRITER_HPP_INCLUDED
+#define HTTP_RESPONSE_WRITER_HPP_INCLUDED
+
+#include "http/http.hpp"
+#include <ostream>
+#include <functional>
+#include <iterator>
+#include <string>
+
+#include <cassert>
+
+namespace http {
+
+    namespace detail {
+        // Enough room for every hex digit of a `size_t`, plus a CRLF...
+        constexpr size_t CHUNK_SIZE_LINE_MAX = sizeof(size_t) * 2 + 2;
+
+        // Formats `value` as a chunk-size line (hex digits followed by
+        // CRLF), right-aligned in `buffer`. Returns a pointer to the first
+        // character of the line, which always ends at the end of `buffer`.
+        inline auto format_chunk_size(
+            size_t value,
+            char (&buffer)[CHUNK_SIZE_LINE_MAX]) noexcept -> char*
+        {
+            constexpr char DIGITS[] = "0123456789abcdef";
+
+            auto* p = std::end(buffer);
+            *--p = '\n';
+            *--p = '\r';
+
+            do {
+                *--p = DIGITS[value & 0xf];
+                value >>= 4;
+            } while (value);
+
+            return p;
+        }
+
+        template<typename T, typename Traits>
+        auto write_chars(std::basic_ostream<T, Traits>& os,
+                         char const* data,
+                         size_t size) -> std::basic_ostream<T, Traits>&
+        {
+            return os.write(reinterpret_cast<T const*>(data), size);
+        }
+    }
+
+    // Writes a response using the "chunked" transfer-coding, so the body
+    // can be sent as the application produces it rather than all at
+    // once. The status line and headers of `head` are written
+    // immediately on construction. Any `Content-Length` or
+    // `Transfer-Encoding` headers in `head` are replaced by
+    // `Transfer-Encoding: chunked`, and its body is ignored.
+    //
+    // Chunked responses are only valid for HTTP/1.1. The body must be
+    // terminated by calling `finish()`; the writer doesn't do this on
+    // destruction.
+    template<typename T, typename Traits = std::char_traits<T>>
+    struct ResponseWriter {
+        ResponseWriter(std::basic_ostream<T, Traits>& os,
+                       HttpResponse const& head) :
+            os_ { os }
+        ,   finished_ { false }
+        {
+            constexpr char NL[] = "\r\n";
+            constexpr char CHUNKED[] = "Transfer-Encoding: chunked\r\n\r\n";
+
+            assert(head.version() == Version::Http11);
+
+            detail::write_status_line(os, head);
+
+            for (auto const& h : head.headers()) {
+                if (detail::iequals(std::get<0>(h), "Content-Length") ||
+                    detail::iequals(std::get<0>(h), "Transfer-Encoding"))
+                {
+                    continue;
+                }
+
+                os << h;
+                detail::write_chars(os, NL, sizeof(NL) - 1);
+            }
+
+            detail::write_chars(os, CHUNKED, sizeof(CHUNKED) - 1);
+        }
+
+        // Writes `size` bytes from `data` as a single chunk. Writing
+        // zero bytes is a no-op, because an empty chunk would terminate
+        // the body...
+        auto write(void const* data, size_t size) -> ResponseWriter& {
+            constexpr char NL[] = "\r\n";
+
+            assert(!finished_);
+
+            if (!size) {
+                return *this;
+            }
+
+            char size_line[detail::CHUNK_SIZE_LINE_MAX];
+            auto const* first = detail::format_chunk_size(size, size_line);
+
+            detail::write_chars(os_.get(),
+                                first,
+                                std::end(size_line) - first);
+            os_.get().write(reinterpret_cast<T const*>(data), size);
+            detail::write_chars(os_.get(), NL, sizeof(NL) - 1);
+
+            return *this;
+        }
+
+        template<
+            typename Iterator,
+            typename std::enable_if<
+                std::is_convertible<
+                    typename std::iterator_traits<Iterator>::iterator_category,
+                    std::random_access_iterator_tag>::value
+            >::type* = nullptr>
+        auto write(Iterator first, Iterator last) -> ResponseWriter& {
+            if (first == last) {
+                return *this;
+            }
+
+            return write(
+                std::addressof(*first),
+                std::distance(first, last) * sizeof(*first));
+        }
+
+        // Pushes everything written so far to the underlying stream's
+        // destination. Call this after the first chunk to get it on the
+        // wire as soon as possible...
+        auto flush() -> ResponseWriter& {
+            os_.get().flush();
+            return *this;
+        }
+
+        // Writes the terminating zero-length chunk, followed by any
+        // `trailers`...
+        auto finish(HeaderContainer const& trailers = HeaderContainer { })
+            -> std::basic_ostream<T, Traits>&
+        {
+            constexpr char LAST_CHUNK[] = "0\r\n";
+            constexpr char NL[] = "\r\n";
+
+            assert(!finished_);
+            finished_ = true;
+
+            auto& os = os_.get();
+            detail::write_chars(os, LAST_CHUNK, sizeof(LAST_CHUNK) - 1);
+
+            for (auto const& h : trailers) {
+                os << h;
+                detail::write_chars(os, NL, sizeof(NL) - 1);
+            }
+
+            return detail::write_chars(os, NL, sizeof(NL) - 1);
+        }
+
+        inline auto is_finished() const noexcept -> bool
+        { return finished_; }
+
+    private:
+        std::reference_wrapper<std::basic_ostream<T, Traits>> os_;
+        bool finished_;
+    };
+
+    template<typename T, typename Traits>
+    auto make_response_writer(std::basic_ostream<T, Traits>& os,
+                              HttpResponse const& head)
+        -> ResponseWriter<T, Traits>
+    {
+        return { os, head };
+    }
+}
+
+#endif //HTTP_RESPONSE_WRITER_HPP_INCLUDED
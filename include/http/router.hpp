@@ -0,0 +1,200 @@
+#ifndef HTTP_ROUTER_HPP_INCLUDED
+#define HTTP_ROUTER_HPP_INCLUDED
+
+#include "result/result.hpp"
+#include "http/http.hpp"
+#include "http/string_view.hpp"
+#include <array>
+#include <string>
+#include <system_error>
+#include <vector>
+#include <cstdint>
+
+namespace http {
+
+    // The maximum number of parameters a single route may capture...
+    constexpr size_t MAX_ROUTE_PARAMETERS = 16;
+
+    // Why `RouterBuilder::with_route()` rejected a route...
+    enum class RouteError {
+        MISSING_LEADING_SLASH = 1,
+        UNNAMED_PARAMETER,
+        MISPLACED_WILDCARD,
+        TOO_MANY_PARAMETERS,
+        DUPLICATE_ROUTE,
+    };
+
+    struct RouteErrorCategory : std::error_category {
+        auto name() const noexcept -> char const* override;
+        auto message(int ec) const -> std::string override;
+    };
+
+    auto route_category() -> RouteErrorCategory const&;
+
+    auto make_error_code(RouteError e) -> std::error_code;
+
+    namespace detail {
+        struct RouteTable;
+    }
+
+    struct RouteParameter {
+        StringView name;
+        StringView value;
+    };
+
+    // The parameters captured by a successful match. Values are views into
+    // the matched path, and names are views into the router...
+    struct RouteParameters {
+        inline auto size() const noexcept -> size_t
+        { return size_; }
+
+        inline auto begin() const noexcept -> RouteParameter const*
+        { return parameters_.data(); }
+
+        inline auto end() const noexcept -> RouteParameter const*
+        { return parameters_.data() + size_; }
+
+        inline auto operator[](size_t n) const noexcept
+            -> RouteParameter const&
+        { return parameters_[n]; }
+
+        // Finds the parameter called `name`. Returns `false` if there
+        // isn't one...
+        auto find(StringView name, StringView& value) const noexcept -> bool {
+            for (auto const& p : *this) {
+                if (p.name == name) {
+                    value = p.value;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+    private:
+        friend struct detail::RouteTable;
+
+        std::array<RouteParameter, MAX_ROUTE_PARAMETERS> parameters_;
+        size_t size_ = 0;
+    };
+
+    namespace detail {
+        // A set of radix trees, one per method, mapping path patterns to
+        // route indices. Patterns are matched segment by segment; within a
+        // segment, static text is preferred over a `:parameter`, which is
+        // preferred over a `*wildcard`.
+        struct RouteTable {
+            RouteTable();
+
+            // Adds `pattern` as route number `route`. Fails with a
+            // `RouteError` if the pattern is malformed, or if `method`
+            // already has a route with the same pattern; the table is
+            // left as it was...
+            auto add(Method method, StringView pattern, size_t route)
+                -> std::error_code;
+
+            // Returns the index of the route matching `path`, or `-1`...
+            auto match(Method method,
+                       StringView path,
+                       RouteParameters& parameters) const noexcept
+                -> std::ptrdiff_t;
+
+        private:
+            struct Edge {
+                std::string label;
+                uint32_t child;
+            };
+
+            struct Node {
+                std::vector<Edge> edges;
+                int32_t param_child = -1;
+                int32_t wildcard_route = -1;
+                int32_t route = -1;
+            };
+
+            auto insert_static(uint32_t node, StringView text) -> uint32_t;
+
+            // Returns the node reached by following `text` from `node`, or
+            // `-1` if the tree has no such node. This doesn't modify the
+            // tree...
+            auto find_static(uint32_t node, StringView text) const noexcept
+                -> int32_t;
+
+            auto match(uint32_t node,
+                       char const* p,
+                       char const* end,
+                       RouteParameters& parameters,
+                       size_t count) const noexcept -> int32_t;
+
+            std::vector<Node> nodes_;
+            std::array<uint32_t, static_cast<size_t>(Method::Trace) + 1> roots_;
+            std::vector<std::vector<std::string>> names_;
+        };
+    }
+
+    // An immutable mapping of method + path patterns to values of `T`,
+    // such as request handlers. Build it once using `RouterBuilder`.
+    //
+    // Patterns are made of '/'-separated segments. A segment of the form
+    // `:name` captures exactly one non-empty segment of the path, and a
+    // final segment of the form `*name` captures the remainder of the
+    // path (which may be empty). E.g. "/users/:id/files/*path".
+    template<typename T>
+    struct Router {
+        template<typename U>
+        friend struct RouterBuilder;
+
+        // Finds the route for `method` and `path`. `path` should be just
+        // the path component of the request-target (see
+        // `HttpRequest::target()`). Returns `nullptr` if no route
+        // matches. This doesn't allocate.
+        auto match(Method method,
+                   StringView path,
+                   RouteParameters& parameters) const noexcept -> T const*
+        {
+            auto n = table_.match(method, path, parameters);
+            return n < 0 ? nullptr : &values_[static_cast<size_t>(n)];
+        }
+
+        inline auto size() const noexcept -> size_t
+        { return values_.size(); }
+
+    private:
+        Router(detail::RouteTable table, std::vector<T> values) :
+            table_ { std::move(table) }
+        ,   values_ { std::move(values) }
+        { }
+
+        detail::RouteTable table_;
+        std::vector<T> values_;
+    };
+
+    template<typename T>
+    struct RouterBuilder {
+        // Adds a route. Fails with a `RouteError` if `pattern` is
+        // malformed, or duplicates an existing route for `method`; the
+        // builder is left as it was, so other routes can still be
+        // added...
+        auto with_route(Method method, StringView pattern, T value)
+            -> result::Result<RouterBuilder*, std::error_code>
+        {
+            auto ec = table_.add(method, pattern, values_.size());
+            if (ec) {
+                return result::err(ec);
+            }
+
+            values_.push_back(std::move(value));
+            return result::ok(this);
+        }
+
+        auto build() && -> Router<T> {
+            return { std::move(table_), std::move(values_) };
+        }
+
+    private:
+        detail::RouteTable table_;
+        std::vector<T> values_;
+    };
+}
+
+#endif //HTTP_ROUTER_HPP_INCLUDED
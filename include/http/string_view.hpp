@@ -0,0 +1,77 @@
+#ifndef HTTP_STRING_VIEW_HPP_INCLUDED
+#define HTTP_STRING_VIEW_HPP_INCLUDED
+
+#include <algorithm>
+#include <string>
+#include <cstddef>
+#include <cstring>
+
+namespace http {
+
+    // A non-owning reference to a sequence of characters, for targeting
+    // compilers that don't provide `std::string_view`...
+    struct StringView {
+        constexpr StringView() noexcept :
+            data_ { nullptr }
+        ,   size_ { 0 }
+        { }
+
+        constexpr StringView(char const* data, size_t size) noexcept :
+            data_ { data }
+        ,   size_ { size }
+        { }
+
+        StringView(char const* s) noexcept :
+            data_ { s }
+        ,   size_ { std::strlen(s) }
+        { }
+
+        StringView(std::string const& s) noexcept :
+            data_ { s.data() }
+        ,   size_ { s.size() }
+        { }
+
+        inline constexpr auto data() const noexcept -> char const*
+        { return data_; }
+
+        inline constexpr auto size() const noexcept -> size_t
+        { return size_; }
+
+        inline constexpr auto empty() const noexcept -> bool
+        { return size_ == 0; }
+
+        inline constexpr auto begin() const noexcept -> char const*
+        { return data_; }
+
+        inline constexpr auto end() const noexcept -> char const*
+        { return data_ + size_; }
+
+        inline constexpr auto operator[](size_t n) const noexcept -> char
+        { return data_[n]; }
+
+        inline auto substr(size_t pos, size_t n) const noexcept -> StringView
+        { return { data_ + pos, std::min(n, size_ - pos) }; }
+
+        inline auto to_string() const -> std::string
+        { return { data_, size_ }; }
+
+    private:
+        char const* data_;
+        size_t size_;
+    };
+
+    inline auto operator==(StringView const& lhs, 
+                           StringView const& rhs) noexcept -> bool
+    {
+        return lhs.size() == rhs.size() &&
+            std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    }
+
+    inline auto operator!=(StringView const& lhs, 
+                           StringView const& rhs) noexcept -> bool
+    {
+        return !(lhs == rhs);
+    }
+}
+
+#endif //HTTP_STRING_VIEW_HPP_INCLUDED
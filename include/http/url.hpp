@@ -0,0 +1,102 @@
+#ifndef HTTP_URL_HPP_INCLUDED
+#define HTTP_URL_HPP_INCLUDED
+
+#include "result/result.hpp"
+#include "http/error.hpp"
+#include "http/string_view.hpp"
+#include <iterator>
+#include <cstdint>
+
+namespace http {
+
+    struct QueryParameter {
+        StringView name;
+        StringView value;
+    };
+
+    // Iterates over the `&`-separated parameters of a query string,
+    // splitting each one as it is reached. Empty parameters are skipped.
+    // Names and values are *not* percent-decoded...
+    struct QueryIterator {
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = QueryParameter;
+        using difference_type = std::ptrdiff_t;
+        using pointer = QueryParameter const*;
+        using reference = QueryParameter const&;
+
+        QueryIterator() noexcept;
+        QueryIterator(char const* first, char const* last) noexcept;
+
+        inline auto operator*() const noexcept -> reference
+        { return current_; }
+
+        inline auto operator->() const noexcept -> pointer
+        { return &current_; }
+
+        auto operator++() noexcept -> QueryIterator&;
+        auto operator++(int) noexcept -> QueryIterator;
+
+        inline auto operator==(QueryIterator const& other) const noexcept 
+            -> bool
+        { return next_ == other.next_ && last_ == other.last_; }
+
+        inline auto operator!=(QueryIterator const& other) const noexcept 
+            -> bool
+        { return !(*this == other); }
+
+    private:
+        char const* next_;
+        char const* last_;
+        QueryParameter current_;
+    };
+
+    struct QueryRange {
+        inline auto begin() const noexcept -> QueryIterator
+        { return { query.begin(), query.end() }; }
+
+        inline auto end() const noexcept -> QueryIterator
+        { return { query.end(), query.end() }; }
+
+        StringView query;
+    };
+
+    // The components of a request-target. Each one is a view into the
+    // string the target was parsed from, so it must outlive this...
+    struct RequestTarget {
+        StringView schema;
+        StringView host;
+        uint16_t port;
+        StringView path;
+        StringView query;
+        StringView fragment;
+
+        inline auto query_parameters() const noexcept -> QueryRange
+        { return { query }; }
+
+        // Finds the first query parameter called `name`. Returns `false` if
+        // there isn't one...
+        auto find_query_parameter(StringView name, 
+                                  StringView& value) const noexcept -> bool;
+    };
+
+    // Splits `target` into its components, using http-parser's
+    // `http_parser_parse_url`. Set `is_connect` for the authority-form
+    // targets used by `CONNECT` requests. Returns
+    // `ParseError::INVALID_URL` on failure.
+    auto parse_target(StringView target, bool is_connect = false) noexcept
+        -> result::Result<RequestTarget, std::error_code>;
+
+    // Percent-decodes `in` into `out`, which must have room for at least
+    // `in.size()` characters (decoding never makes the text longer).
+    // `out` may be `in.data()`, to decode in place. If `plus_as_space` is
+    // set then `+` is decoded as a space, as used by
+    // `application/x-www-form-urlencoded` query strings. Returns the
+    // decoded length, or `ParseError::INVALID_URL` for a malformed escape.
+    auto percent_decode(StringView in, 
+                        char* out, 
+                        size_t out_size,
+                        bool plus_as_space = false) noexcept
+        -> result::Result<size_t, std::error_code>;
+}
+
+#endif //HTTP_URL_HPP_INCLUDED
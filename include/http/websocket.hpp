@@ -0,0 +1,179 @@
+#ifndef HTTP_WEBSOCKET_HPP_INCLUDED
+#define HTTP_WEBSOCKET_HPP_INCLUDED
+
+#include "result/result.hpp"
+#include "http/http.hpp"
+#include "http/buffer.hpp"
+#include "http/string_view.hpp"
+#include <array>
+#include <limits>
+#include <ostream>
+#include <system_error>
+#include <cstdint>
+
+namespace http {
+
+    enum class WebSocketError {
+        NOT_A_HANDSHAKE = 1,
+        UNSUPPORTED_VERSION,
+        INVALID_KEY,
+        RESERVED_BITS_SET,
+        INVALID_OPCODE,
+        FRAGMENTED_CONTROL_FRAME,
+        CONTROL_FRAME_TOO_LARGE,
+        NON_MINIMAL_LENGTH,
+        FRAME_TOO_LARGE,
+        UNMASKED_FRAME,
+    };
+
+    struct WebSocketErrorCategory : std::error_category {
+        auto name() const noexcept -> char const* override;
+        auto message(int ec) const -> std::string override;
+    };
+
+    auto websocket_category() -> WebSocketErrorCategory const&;
+
+    auto make_error_code(WebSocketError e) -> std::error_code;
+
+    // The length of a `Sec-WebSocket-Accept` value...
+    constexpr size_t WEBSOCKET_ACCEPT_LENGTH = 28;
+
+    // Computes the `Sec-WebSocket-Accept` value for the client's
+    // `Sec-WebSocket-Key`, writing `WEBSOCKET_ACCEPT_LENGTH` characters to
+    // `out`...
+    auto websocket_accept(StringView key, 
+                          char (&out)[WEBSOCKET_ACCEPT_LENGTH]) noexcept 
+        -> void;
+
+    // `true` if `request` is a valid WebSocket opening handshake...
+    auto is_websocket_handshake(HttpRequest const& request) noexcept -> bool;
+
+    // Builds the `101 Switching Protocols` response accepting `request`'s
+    // opening handshake. Fails with `WebSocketError::NOT_A_HANDSHAKE`,
+    // `UNSUPPORTED_VERSION` or `INVALID_KEY`. Further headers (e.g.
+    // `Sec-WebSocket-Protocol`) can be added with `set_header()`.
+    auto make_websocket_handshake(HttpRequest const& request)
+        -> result::Result<HttpResponse, std::error_code>;
+
+    // The size of the response written by `render_websocket_handshake()`
+    constexpr size_t WEBSOCKET_HANDSHAKE_SIZE = 
+        sizeof("HTTP/1.1 101 Switching Protocols\r\n"
+               "Upgrade: websocket\r\n"
+               "Connection: Upgrade\r\n"
+               "Sec-WebSocket-Accept: \r\n"
+               "\r\n") - 1 + WEBSOCKET_ACCEPT_LENGTH;
+
+    // Writes the handshake response for `key` straight into `out`, which
+    // must have room for `WEBSOCKET_HANDSHAKE_SIZE` bytes. The caller is
+    // responsible for validating the request first...
+    auto render_websocket_handshake(StringView key, char* out) noexcept 
+        -> size_t;
+
+    enum class Opcode : uint8_t {
+        Continuation = 0x0,
+        Text = 0x1,
+        Binary = 0x2,
+        Close = 0x8,
+        Ping = 0x9,
+        Pong = 0xa,
+    };
+
+    // A parsed frame. `payload` points into the buffer the frame was
+    // parsed from, so it is only valid as long as that buffer is...
+    struct WebSocketFrame {
+        bool fin;
+        Opcode opcode;
+        bool masked;
+        std::array<uint8_t, 4> mask;
+        uint8_t* payload;
+        size_t payload_size;
+    };
+
+    struct FrameParseOptions {
+        // Frames with larger payloads fail with
+        // `WebSocketError::FRAME_TOO_LARGE`...
+        size_t max_payload_size = 16 * 1024 * 1024;
+
+        // Servers must reject unmasked frames from clients; clients must
+        // accept unmasked frames from servers...
+        bool require_mask = true;
+
+        // Unmask the payload in place. When `false`, `payload` is left as
+        // it was received, and can be unmasked later with `apply_mask()`
+        bool unmask = true;
+    };
+
+    // Parses a frame from the front of `[data, data + size)`. Returns the
+    // number of bytes the frame occupies, or `0` if more data is needed
+    // before it is complete (`frame` is left unchanged in that case).
+    auto parse_frame(uint8_t* data,
+                     size_t size,
+                     WebSocketFrame& frame,
+                     FrameParseOptions const& options = FrameParseOptions { })
+        -> result::Result<size_t, std::error_code>;
+
+    // XORs `[data, data + size)` with `mask`, as if the data started
+    // `offset` bytes into the payload. Masking and unmasking are the same
+    // operation. This works a vector register at a time where possible...
+    auto apply_mask(uint8_t* data,
+                    size_t size,
+                    std::array<uint8_t, 4> const& mask,
+                    size_t offset = 0) noexcept -> void;
+
+    // The largest frame header `write_frame_header()` can produce...
+    constexpr size_t MAX_FRAME_HEADER_SIZE = 14;
+
+    // Writes the header for a frame carrying `payload_size` bytes into
+    // `out`, which must have room for `MAX_FRAME_HEADER_SIZE` bytes. If
+    // `mask` isn't `nullptr` the frame is marked as masked; the payload
+    // must then be masked with `apply_mask()` before it is sent. Returns
+    // the size of the header.
+    auto write_frame_header(uint8_t* out,
+                            Opcode opcode,
+                            size_t payload_size,
+                            bool fin = true,
+                            std::array<uint8_t, 4> const* mask = nullptr)
+        noexcept -> size_t;
+
+    // Storage for a frame header, for `frame_buffers()`. It must outlive
+    // the write...
+    struct FrameHeaderBuffer {
+        uint8_t data[MAX_FRAME_HEADER_SIZE];
+    };
+
+    // Returns an unmasked frame as buffers suitable for a vectored write.
+    // The payload isn't copied...
+    inline auto frame_buffers(FrameHeaderBuffer& header,
+                              Opcode opcode,
+                              void const* payload,
+                              size_t payload_size,
+                              bool fin = true) noexcept
+        -> std::array<ConstBuffer, 2>
+    {
+        auto n = write_frame_header(header.data, opcode, payload_size, fin);
+        return {{ { header.data, n }, { payload, payload_size } }};
+    }
+
+    // Writes an unmasked frame to `os`...
+    template<typename T, typename Traits>
+    auto write_frame(std::basic_ostream<T, Traits>& os,
+                     Opcode opcode,
+                     void const* payload,
+                     size_t payload_size,
+                     bool fin = true) -> std::basic_ostream<T, Traits>&
+    {
+        auto header = FrameHeaderBuffer { };
+        for (auto const& b : frame_buffers(header, 
+                                           opcode, 
+                                           payload, 
+                                           payload_size, 
+                                           fin)) 
+        {
+            os.write(reinterpret_cast<T const*>(b.data), b.size);
+        }
+
+        return os;
+    }
+}
+
+#endif //HTTP_WEBSOCKET_HPP_INCLUDED
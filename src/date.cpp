@@ -0,0 +1,90 @@
+#include "http/date.hpp"
+
+using namespace http;
+
+namespace {
+
+    struct CachedDate {
+        std::time_t second;
+        char text[DATE_LENGTH + 1];
+    };
+
+    thread_local CachedDate CACHED_DATE = { -1, { } };
+
+    auto write_2_digits(char* out, unsigned value) noexcept -> void {
+        out[0] = static_cast<char>('0' + (value / 10) % 10);
+        out[1] = static_cast<char>('0' + value % 10);
+    }
+}
+
+auto http::format_date(std::time_t t, char* out) noexcept -> void {
+    constexpr char DAYS[] = "SunMonTueWedThuFriSat";
+    constexpr char MONTHS[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    constexpr long long SECONDS_PER_DAY = 86400;
+
+    auto const secs = static_cast<long long>(t);
+    auto days = secs / SECONDS_PER_DAY;
+    auto rem = secs % SECONDS_PER_DAY;
+    if (rem < 0) {
+        rem += SECONDS_PER_DAY;
+        days -= 1;
+    }
+
+    // 1970-01-01 was a Thursday...
+    auto const weekday = static_cast<unsigned>(((days % 7) + 11) % 7);
+
+    // Converts days since the epoch to a civil date. This is Howard
+    // Hinnant's `civil_from_days` algorithm...
+    auto const z = days + 719468;
+    auto const era = (z >= 0 ? z : z - 146096) / 146097;
+    auto const doe = static_cast<unsigned>(z - era * 146097);
+    auto const yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+    auto const doy = doe - (365*yoe + yoe/4 - yoe/100);
+    auto const mp = (5*doy + 2) / 153;
+    auto const day = doy - (153*mp + 2)/5 + 1;
+    auto const month = mp < 10 ? mp + 3 : mp - 9;
+    auto const year = static_cast<long long>(yoe) + era * 400 +
+        (month <= 2 ? 1 : 0);
+
+    auto const hour = static_cast<unsigned>(rem / 3600);
+    auto const minute = static_cast<unsigned>((rem % 3600) / 60);
+    auto const second = static_cast<unsigned>(rem % 60);
+
+    // "Sun, 06 Nov 1994 08:49:37 GMT"
+    out[0] = DAYS[weekday * 3];
+    out[1] = DAYS[weekday * 3 + 1];
+    out[2] = DAYS[weekday * 3 + 2];
+    out[3] = ',';
+    out[4] = ' ';
+    write_2_digits(out + 5, day);
+    out[7] = ' ';
+    out[8] = MONTHS[(month - 1) * 3];
+    out[9] = MONTHS[(month - 1) * 3 + 1];
+    out[10] = MONTHS[(month - 1) * 3 + 2];
+    out[11] = ' ';
+    write_2_digits(out + 12, static_cast<unsigned>(year / 100));
+    write_2_digits(out + 14, static_cast<unsigned>(year % 100));
+    out[16] = ' ';
+    write_2_digits(out + 17, hour);
+    out[19] = ':';
+    write_2_digits(out + 20, minute);
+    out[22] = ':';
+    write_2_digits(out + 23, second);
+    out[25] = ' ';
+    out[26] = 'G';
+    out[27] = 'M';
+    out[28] = 'T';
+}
+
+auto http::current_date() noexcept -> char const* {
+    auto& cached = CACHED_DATE;
+    auto const now = std::time(nullptr);
+
+    if (now != cached.second) {
+        format_date(now, cached.text);
+        cached.text[DATE_LENGTH] = '\0';
+        cached.second = now;
+    }
+
+    return cached.text;
+}
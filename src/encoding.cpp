@@ -0,0 +1,386 @@
+#include "http/encoding.hpp"
+#include <algorithm>
+#include <limits>
+#include <new>
+#include <zlib.h>
+
+#include <cassert>
+
+using namespace http;
+
+namespace {
+
+    // zlib counts in `uInt`, so larger buffers are processed in pieces...
+    constexpr size_t MAX_ZLIB_SIZE = std::numeric_limits<uInt>::max();
+
+    auto zlib_error(int rc) -> std::error_code {
+        return std::make_error_code(
+            rc == Z_MEM_ERROR
+                ? std::errc::not_enough_memory
+                : std::errc::io_error);
+    }
+
+    auto is_space(char c) -> bool {
+        return c == ' ' || c == '\t';
+    }
+
+    auto iequals(char const* first, char const* last, char const* rhs)
+        -> bool
+    {
+        return detail::iequals(first,
+                               last,
+                               rhs,
+                               rhs + std::char_traits<char>::length(rhs));
+    }
+
+    // Parses the `q` parameter of an `Accept-Encoding` element, as an
+    // integer between 0 and 1000...
+    auto parse_qvalue(char const* first, char const* last) -> int {
+        while (first != last && is_space(*first)) { ++first; }
+
+        if ((last - first) < 2 ||
+            (first[0] != 'q' && first[0] != 'Q') ||
+            first[1] != '=')
+        {
+            return 1000;
+        }
+
+        first += 2;
+
+        auto q = 0;
+        auto scale = 1000;
+        auto seen_point = false;
+        for (; first != last && !is_space(*first); ++first) {
+            if (*first == '.' && !seen_point) {
+                seen_point = true;
+            }
+            else if (*first >= '0' && *first <= '9') {
+                if (!seen_point) {
+                    q = q * 10 + (*first - '0') * 1000;
+                }
+                else if (scale > 1) {
+                    scale /= 10;
+                    q += (*first - '0') * scale;
+                }
+            }
+            else {
+                return 0;
+            }
+        }
+
+        return std::min(q, 1000);
+    }
+}
+
+auto http::negotiate_encoding(HttpRequest const& request) -> ContentCoding {
+    auto gzip = -1;
+    auto deflate = -1;
+    auto any = -1;
+
+    for (auto const& h : request.headers()) {
+        if (!detail::iequals(std::get<0>(h), "Accept-Encoding")) {
+            continue;
+        }
+
+        auto const* p = std::get<1>(h).data();
+        auto const* end = p + std::get<1>(h).size();
+
+        while (p != end) {
+            auto const* next = std::find(p, end, ',');
+            auto const* semi = std::find(p, next, ';');
+            auto const* first = p;
+            auto const* last = semi;
+
+            while (first != last && is_space(*first)) { ++first; }
+            while (last != first && is_space(*(last-1))) { --last; }
+
+            auto q = semi == next ? 1000 : parse_qvalue(semi + 1, next);
+
+            if (iequals(first, last, "gzip") ||
+                iequals(first, last, "x-gzip"))
+            {
+                gzip = q;
+            }
+            else if (iequals(first, last, "deflate")) {
+                deflate = q;
+            }
+            else if (iequals(first, last, "*")) {
+                any = q;
+            }
+
+            p = (next == end) ? end : next + 1;
+        }
+    }
+
+    // A wildcard applies to any coding not explicitly listed...
+    if (gzip < 0) { gzip = any; }
+    if (deflate < 0) { deflate = any; }
+
+    if (gzip > 0 && gzip >= deflate) {
+        return ContentCoding::Gzip;
+    }
+
+    if (deflate > 0) {
+        return ContentCoding::Deflate;
+    }
+
+    return ContentCoding::Identity;
+}
+
+auto http::detail::add_vary(HeaderContainer& headers, char const* name) 
+    -> void
+{
+    auto vary = headers.end();
+    for (auto it = headers.begin(); it != headers.end(); ++it) {
+        if (!detail::iequals(std::get<0>(*it), "Vary")) {
+            continue;
+        }
+
+        if (vary == headers.end()) {
+            vary = it;
+        }
+
+        auto const* p = std::get<1>(*it).data();
+        auto const* end = p + std::get<1>(*it).size();
+
+        while (p != end) {
+            auto const* next = std::find(p, end, ',');
+            auto const* first = p;
+            auto const* last = next;
+
+            while (first != last && is_space(*first)) { ++first; }
+            while (last != first && is_space(*(last-1))) { --last; }
+
+            if (::iequals(first, last, name) || ::iequals(first, last, "*")) {
+                return;
+            }
+
+            p = (next == end) ? end : next + 1;
+        }
+    }
+
+    if (vary == headers.end()) {
+        headers.emplace_back("Vary", name);
+        return;
+    }
+
+    auto& value = std::get<1>(*vary);
+    if (value.find_first_not_of(" \t") == std::string::npos) {
+        value = name;
+    }
+    else {
+        value += ", ";
+        value += name;
+    }
+}
+
+struct Encoder::State {
+    z_stream stream;
+    bool finished;
+};
+
+Encoder::Encoder(std::unique_ptr<State> state) noexcept :
+    state_ { std::move(state) }
+{ }
+
+auto Encoder::create(ContentCoding coding, int level) noexcept
+    -> result::Result<Encoder, std::error_code>
+{
+    assert(coding != ContentCoding::Identity);
+
+    auto state = std::unique_ptr<State> { new (std::nothrow) State { } };
+    if (!state) {
+        return result::err(std::make_error_code(std::errc::not_enough_memory));
+    }
+
+    state->stream = z_stream { };
+    state->finished = false;
+
+    // `windowBits` of 15 produces a zlib stream (which is what HTTP calls
+    // "deflate"). Adding 16 produces a gzip stream instead...
+    auto rc = deflateInit2(&state->stream,
+                           std::max(1, std::min(level, 9)),
+                           Z_DEFLATED,
+                           coding == ContentCoding::Gzip ? 15 + 16 : 15,
+                           8,
+                           Z_DEFAULT_STRATEGY);
+    if (rc != Z_OK) {
+        return result::err(zlib_error(rc));
+    }
+
+    return result::ok(Encoder { std::move(state) });
+}
+
+Encoder::Encoder(Encoder&&) noexcept = default;
+auto Encoder::operator=(Encoder&&) noexcept -> Encoder& = default;
+
+Encoder::~Encoder() {
+    if (state_) {
+        deflateEnd(&state_->stream);
+    }
+}
+
+auto Encoder::encode(uint8_t const* in,
+                     size_t in_size,
+                     size_t& consumed,
+                     uint8_t* out,
+                     size_t out_size,
+                     EncodeFlush flush)
+    -> result::Result<size_t, std::error_code>
+{
+    assert(state_);
+
+    auto& z = state_->stream;
+    auto const avail_in = static_cast<uInt>(std::min(in_size, MAX_ZLIB_SIZE));
+    auto const avail_out = static_cast<uInt>(std::min(out_size, MAX_ZLIB_SIZE));
+
+    z.next_in = const_cast<Bytef*>(in);
+    z.avail_in = avail_in;
+    z.next_out = out;
+    z.avail_out = avail_out;
+
+    // The flush only applies once the last of the input is in...
+    auto mode = Z_NO_FLUSH;
+    if (avail_in == in_size) {
+        mode = flush == EncodeFlush::Finish ? Z_FINISH
+             : flush == EncodeFlush::Sync ? Z_SYNC_FLUSH
+             : Z_NO_FLUSH;
+    }
+
+    auto rc = deflate(&z, mode);
+
+    consumed = avail_in - z.avail_in;
+
+    if (rc == Z_STREAM_END) {
+        state_->finished = true;
+    }
+    else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+        return result::err(zlib_error(rc));
+    }
+
+    return result::ok(static_cast<size_t>(avail_out - z.avail_out));
+}
+
+auto Encoder::is_finished() const noexcept -> bool {
+    return state_ && state_->finished;
+}
+
+struct Decoder::State {
+    z_stream stream;
+    ContentCoding coding;
+    bool started;
+    bool finished;
+};
+
+Decoder::Decoder(std::unique_ptr<State> state) noexcept :
+    state_ { std::move(state) }
+{ }
+
+auto Decoder::create(ContentCoding coding) noexcept
+    -> result::Result<Decoder, std::error_code>
+{
+    assert(coding != ContentCoding::Identity);
+
+    auto state = std::unique_ptr<State> { new (std::nothrow) State { } };
+    if (!state) {
+        return result::err(std::make_error_code(std::errc::not_enough_memory));
+    }
+
+    state->stream = z_stream { };
+    state->coding = coding;
+    state->started = false;
+    state->finished = false;
+
+    // Adding 32 to `windowBits` makes zlib detect a gzip or zlib header
+    // automatically...
+    auto rc = inflateInit2(&state->stream, 15 + 32);
+    if (rc != Z_OK) {
+        return result::err(zlib_error(rc));
+    }
+
+    return result::ok(Decoder { std::move(state) });
+}
+
+Decoder::Decoder(Decoder&&) noexcept = default;
+auto Decoder::operator=(Decoder&&) noexcept -> Decoder& = default;
+
+Decoder::~Decoder() {
+    if (state_) {
+        inflateEnd(&state_->stream);
+    }
+}
+
+auto Decoder::decode(uint8_t const* in,
+                     size_t in_size,
+                     size_t& consumed,
+                     uint8_t* out,
+                     size_t out_size) -> result::Result<size_t, std::error_code>
+{
+    assert(state_);
+
+    consumed = 0;
+    if (state_->finished) {
+        return result::ok(static_cast<size_t>(0));
+    }
+
+    auto& z = state_->stream;
+    auto const avail_in = static_cast<uInt>(std::min(in_size, MAX_ZLIB_SIZE));
+    auto const avail_out = static_cast<uInt>(std::min(out_size, MAX_ZLIB_SIZE));
+
+    z.next_in = const_cast<Bytef*>(in);
+    z.avail_in = avail_in;
+    z.next_out = out;
+    z.avail_out = avail_out;
+
+    auto rc = inflate(&z, Z_NO_FLUSH);
+
+    // Some clients send raw deflate data, without the zlib wrapper, as
+    // "deflate". If the very first bytes aren't a valid header then try
+    // again, expecting raw data...
+    if (rc == Z_DATA_ERROR &&
+        !state_->started &&
+        state_->coding == ContentCoding::Deflate)
+    {
+        inflateEnd(&z);
+        z = z_stream { };
+        rc = inflateInit2(&z, -15);
+        if (rc != Z_OK) {
+            return result::err(zlib_error(rc));
+        }
+
+        z.next_in = const_cast<Bytef*>(in);
+        z.avail_in = avail_in;
+        z.next_out = out;
+        z.avail_out = avail_out;
+
+        rc = inflate(&z, Z_NO_FLUSH);
+    }
+
+    state_->started = true;
+    consumed = avail_in - z.avail_in;
+
+    if (rc == Z_STREAM_END) {
+        state_->finished = true;
+    }
+    else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+        return result::err(make_error_code(ParseError::INVALID_CONTENT_ENCODING));
+    }
+
+    return result::ok(static_cast<size_t>(avail_out - z.avail_out));
+}
+
+auto Decoder::is_finished() const noexcept -> bool {
+    return state_ && state_->finished;
+}
+
+auto Decoder::reset() noexcept -> std::error_code {
+    assert(state_);
+
+    auto rc = inflateReset(&state_->stream);
+    if (rc != Z_OK) {
+        return zlib_error(rc);
+    }
+
+    state_->finished = false;
+    return { };
+}
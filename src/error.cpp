@@ -1,9 +1,50 @@
 #include "http/error.hpp"
+#include <array>
+#include <atomic>
 
 using namespace http;
 
 ParseErrorCategory const PARSE_ERROR_CATEGORY_INSTANCE { };
 
+namespace {
+
+    // http-parser's codes are dense from 1, and this library's are dense
+    // from 100, so each range gets its own block of counters...
+    constexpr int LAST_PARSER_ERROR = static_cast<int>(ParseError::UNKNOWN);
+    constexpr int FIRST_LIBRARY_ERROR = 
+        static_cast<int>(ParseError::UNSUPPORTED_CONTENT_ENCODING);
+    constexpr int LAST_LIBRARY_ERROR = 
+        static_cast<int>(ParseError::BODY_TOO_LARGE);
+
+    constexpr size_t COUNTER_COUNT = 
+        LAST_PARSER_ERROR + 1 + (LAST_LIBRARY_ERROR - FIRST_LIBRARY_ERROR + 1);
+
+    std::array<std::atomic<uint64_t>, COUNTER_COUNT> ERROR_COUNTS { };
+
+    // Returns the counter for `ec`, or `COUNTER_COUNT` if it doesn't have
+    // one...
+    auto counter_index(int ec) noexcept -> size_t {
+        if (ec >= 1 && ec <= LAST_PARSER_ERROR) {
+            return static_cast<size_t>(ec);
+        }
+
+        if (ec >= FIRST_LIBRARY_ERROR && ec <= LAST_LIBRARY_ERROR) {
+            return static_cast<size_t>(
+                LAST_PARSER_ERROR + 1 + (ec - FIRST_LIBRARY_ERROR));
+        }
+
+        return COUNTER_COUNT;
+    }
+
+    auto counter_error(size_t index) noexcept -> ParseError {
+        return static_cast<ParseError>(
+            index <= static_cast<size_t>(LAST_PARSER_ERROR)
+                ? static_cast<int>(index)
+                : static_cast<int>(index) - LAST_PARSER_ERROR - 1 + 
+                      FIRST_LIBRARY_ERROR);
+    }
+}
+
 auto ParseErrorCategory::name() const noexcept -> char const* {
     return "parse";
 }
@@ -73,6 +114,18 @@ auto ParseErrorCategory::message(int ec) const -> std::string {
             return "strict mode assertion failed";
         case ParseError::PAUSED: 
             return "parser is paused";
+        case ParseError::UNSUPPORTED_CONTENT_ENCODING:
+            return "unsupported content-encoding";
+        case ParseError::INVALID_CONTENT_ENCODING:
+            return "body could not be decoded using its content-encoding";
+        case ParseError::HEADERS_TOO_LARGE:
+            return "headers exceed the configured size limit";
+        case ParseError::TOO_MANY_HEADERS:
+            return "headers exceed the configured count limit";
+        case ParseError::URL_TOO_LONG:
+            return "request-target exceeds the configured length limit";
+        case ParseError::BODY_TOO_LARGE:
+            return "body exceeds the configured size limit";
         default: 
             return "an unknown error occurred";
     }
@@ -85,3 +138,41 @@ auto http::parse_category() -> ParseErrorCategory const& {
 auto http::make_error_code(ParseError e) -> std::error_code {
     return { static_cast<int>(e), PARSE_ERROR_CATEGORY_INSTANCE };
 }
+
+auto http::parse_error_count(ParseError e) noexcept -> uint64_t {
+    auto n = counter_index(static_cast<int>(e));
+    return n < COUNTER_COUNT 
+        ? ERROR_COUNTS[n].load(std::memory_order_relaxed) 
+        : 0;
+}
+
+auto http::parse_error_counts() -> std::vector<ParseErrorCount> {
+    auto counts = std::vector<ParseErrorCount> { };
+    for (size_t i = 1; i < COUNTER_COUNT; ++i) {
+        auto n = ERROR_COUNTS[i].load(std::memory_order_relaxed);
+        if (n) {
+            counts.push_back({ counter_error(i), n });
+        }
+    }
+
+    return counts;
+}
+
+auto http::reset_parse_error_counts() noexcept -> void {
+    for (auto& c : ERROR_COUNTS) {
+        c.store(0, std::memory_order_relaxed);
+    }
+}
+
+auto http::detail::count_parse_error(std::error_code const& ec) noexcept 
+    -> void
+{
+    if (ec.category() != PARSE_ERROR_CATEGORY_INSTANCE) {
+        return;
+    }
+
+    auto n = counter_index(ec.value());
+    if (n < COUNTER_COUNT) {
+        ERROR_COUNTS[n].fetch_add(1, std::memory_order_relaxed);
+    }
+}
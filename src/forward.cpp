@@ -0,0 +1,242 @@
+#include "http/forward.hpp"
+#include "http/string_view.hpp"
+#include <algorithm>
+#include <cassert>
+#include <functional>
+
+using namespace http;
+
+namespace {
+
+    // Headers that only apply to a single connection. `Transfer-Encoding`
+    // is hop-by-hop too, but the body is forwarded with its original
+    // framing, so the header that describes it must be kept...
+    char const* const HOP_BY_HOP[] = {
+        "Connection",
+        "Keep-Alive",
+        "Proxy-Connection",
+        "Proxy-Authenticate",
+        "Proxy-Authorization",
+        "TE",
+        "Upgrade",
+    };
+
+    auto name_equals(StringView lhs, char const* rhs) noexcept -> bool {
+        return detail::iequals(lhs.begin(),
+                               lhs.end(),
+                               rhs,
+                               rhs + std::char_traits<char>::length(rhs));
+    }
+
+    auto is_space(char c) noexcept -> bool {
+        return c == ' ' || c == '\t';
+    }
+
+    // `true` if `name` is listed in any `Connection` header...
+    auto is_connection_option(StringView name, 
+                              HeaderContainer const& headers) noexcept
+        -> bool
+    {
+        for (auto const& h : headers) {
+            if (!detail::iequals(std::get<0>(h), "Connection")) {
+                continue;
+            }
+
+            auto const* p = std::get<1>(h).data();
+            auto const* end = p + std::get<1>(h).size();
+            while (p != end) {
+                auto const* next = std::find(p, end, ',');
+                auto const* first = p;
+                auto const* last = next;
+
+                while (first != last && is_space(*first)) { ++first; }
+                while (last != first && is_space(*(last-1))) { --last; }
+
+                if (detail::iequals(name.begin(), name.end(), first, last)) {
+                    return true;
+                }
+
+                p = (next == end) ? end : next + 1;
+            }
+        }
+
+        return false;
+    }
+
+#ifndef NDEBUG
+    // `true` if `body` was parsed in place, out of `[data, data + size)`.
+    // Those bytes may have been rewritten, so they can't be forwarded...
+    auto is_view_into(Body const& body, char const* data, size_t size)
+        noexcept -> bool
+    {
+        auto const* p = reinterpret_cast<char const*>(body.data());
+        auto const before = std::less<char const*> { };
+        return body.is_view() &&
+            !body.empty() &&
+            !before(p, data) &&
+            before(p, data + size);
+    }
+#endif
+
+    auto append(std::vector<char>& out, std::string const& s) -> void {
+        out.insert(out.end(), s.begin(), s.end());
+    }
+
+    auto append_header(std::vector<char>& out,
+                       std::string const& name,
+                       std::string const& value) -> void
+    {
+        append(out, name);
+        out.push_back(':');
+        out.push_back(' ');
+        append(out, value);
+        out.push_back('\r');
+        out.push_back('\n');
+    }
+}
+
+struct http::detail::Forwarder {
+    Forwarder(HeaderContainer const& headers, 
+              ForwardOptions const& options, 
+              bool is_request) :
+        headers { headers }
+    ,   options { options }
+    ,   replace_forwarded_for { is_request && !options.forwarded_for.empty() }
+    { }
+
+    auto should_remove(StringView name) const noexcept -> bool {
+        for (auto const* h : HOP_BY_HOP) {
+            if (name_equals(name, h)) {
+                return true;
+            }
+        }
+
+        if (replace_forwarded_for && name_equals(name, "X-Forwarded-For")) {
+            return true;
+        }
+
+        for (auto const& r : options.remove) {
+            if (name_equals(name, r.c_str())) {
+                return true;
+            }
+        }
+
+        return is_connection_option(name, headers);
+    }
+
+    // The header lines that are spliced in before the end of the head...
+    auto inserted_headers() const -> std::vector<char> {
+        auto out = std::vector<char> { };
+
+        if (replace_forwarded_for) {
+            auto value = std::string { };
+            for (auto const& h : headers) {
+                if (iequals(std::get<0>(h), "X-Forwarded-For")) {
+                    value += std::get<1>(h);
+                    value += ", ";
+                }
+            }
+
+            value += options.forwarded_for;
+            append_header(out, "X-Forwarded-For", value);
+        }
+
+        for (auto const& h : options.add) {
+            append_header(out, std::get<0>(h), std::get<1>(h));
+        }
+
+        return out;
+    }
+
+    auto forward(char const* data, size_t size) const -> ForwardedMessage {
+        auto message = ForwardedMessage { };
+        message.storage_ = inserted_headers();
+
+        auto& buffers = message.buffers_;
+        auto const push = [&](char const* first, char const* last) {
+            if (first == last) {
+                return;
+            }
+
+            // Adjacent spans are merged, so unchanged runs of headers
+            // become a single buffer...
+            if (!buffers.empty() &&
+                static_cast<char const*>(buffers.back().data) + 
+                    buffers.back().size == first)
+            {
+                buffers.back().size += static_cast<size_t>(last - first);
+                return;
+            }
+
+            buffers.push_back({ first, static_cast<size_t>(last - first) });
+        };
+
+        auto const* end = data + size;
+
+        // The start line is always kept...
+        auto const* p = std::find(data, end, '\n');
+        p = (p == end) ? end : p + 1;
+        push(data, p);
+
+        // Walk the header lines, skipping the ones that are removed. A line
+        // that starts with whitespace continues the previous header...
+        auto remove = false;
+        while (p != end) {
+            auto const* eol = std::find(p, end, '\n');
+            auto const* next = (eol == end) ? end : eol + 1;
+            auto const* content_end = 
+                (eol != p && *(eol-1) == '\r') ? eol - 1 : eol;
+
+            if (content_end == p) {
+                break;
+            }
+
+            if (!is_space(*p)) {
+                auto const* colon = std::find(p, content_end, ':');
+                remove = should_remove({ p, static_cast<size_t>(colon - p) });
+            }
+
+            if (!remove) {
+                push(p, next);
+            }
+
+            p = next;
+        }
+
+        if (!message.storage_.empty()) {
+            buffers.push_back({ 
+                message.storage_.data(), 
+                message.storage_.size() 
+            });
+        }
+
+        // The blank line that ends the head, and the body, are kept...
+        push(p, end);
+
+        return message;
+    }
+
+    HeaderContainer const& headers;
+    ForwardOptions const& options;
+    bool replace_forwarded_for;
+};
+
+auto http::forward_request(char const* data,
+                           size_t size,
+                           HttpRequest const& request,
+                           ForwardOptions const& options) -> ForwardedMessage
+{
+    assert(!is_view_into(request.body(), data, size));
+    return detail::Forwarder { request.headers(), options, true }
+        .forward(data, size);
+}
+
+auto http::forward_response(char const* data,
+                            size_t size,
+                            HttpResponse const& response,
+                            ForwardOptions const& options) -> ForwardedMessage
+{
+    assert(!is_view_into(response.body(), data, size));
+    return detail::Forwarder { response.headers(), options, false }
+        .forward(data, size);
+}
@@ -1,12 +1,21 @@
 #include "http/http.hpp"
+#include "http/date.hpp"
 #include <cctype>
-#include <numeric>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+#ifdef HTTP_HAS_ZLIB
+#include "http/encoding.hpp"
+#endif
 
 using namespace http;
 
 HttpRequest::HttpRequest(HttpRequestProtocolHeader h, 
                          HeaderContainer c,
-                         BodyContainer b)
+                         Body b)
     :   protocol_ { std::move(h) }
     ,   headers_ { std::move(c) }
     ,   body_ { std::move(b) }
@@ -33,17 +42,20 @@ auto HttpRequestHeaderBuilder::with_headers(std::initializer_list<Header> h) &&
 }
 
 auto HttpRequestHeaderBuilder::build() && -> HttpRequest {
-    return std::move(*this).build(BodyContainer { });
+    return std::move(*this).build(Body { });
 }
 
-auto HttpRequestHeaderBuilder::build(BodyContainer body) && 
+auto HttpRequestHeaderBuilder::build(Body body) && 
     -> HttpRequest 
 {
-    return {
+    auto message = HttpRequest {
         std::move(proto_),
         std::move(headers_),
         std::move(body)
     };
+
+    message.upgrade_ = upgrade_;
+    return message;
 }
 
 auto HttpRequestBuilder::with_protocol(HttpRequestProtocolHeader p) && 
@@ -54,7 +66,7 @@ auto HttpRequestBuilder::with_protocol(HttpRequestProtocolHeader p) &&
 
 HttpResponse::HttpResponse(HttpResponseProtocolHeader h, 
                            HeaderContainer c,
-                           BodyContainer b)
+                           Body b)
     :   protocol_ { std::move(h) }
     ,   headers_ { std::move(c) }
     ,   body_ { std::move(b) }
@@ -80,18 +92,29 @@ auto HttpResponseHeaderBuilder::with_headers(std::initializer_list<Header> h) &&
     return std::move(*this);
 }
 
+auto HttpResponseHeaderBuilder::with_date() && 
+    -> HttpResponseHeaderBuilder&&
+{
+    headers_.emplace_back("Date", 
+                          std::string { current_date(), DATE_LENGTH });
+    return std::move(*this);
+}
+
 auto HttpResponseHeaderBuilder::build() && -> HttpResponse {
-    return std::move(*this).build(BodyContainer { });
+    return std::move(*this).build(Body { });
 }
 
-auto HttpResponseHeaderBuilder::build(BodyContainer body) && 
+auto HttpResponseHeaderBuilder::build(Body body) && 
     -> HttpResponse 
 {
-    return {
+    auto message = HttpResponse {
         std::move(proto_),
         std::move(headers_),
         std::move(body)
     };
+
+    message.upgrade_ = upgrade_;
+    return message;
 }
 
 auto HttpResponseBuilder::with_protocol(HttpResponseProtocolHeader p) && 
@@ -100,297 +123,1115 @@ auto HttpResponseBuilder::with_protocol(HttpResponseProtocolHeader p) &&
     return { std::move(p) };        
 }
 
-struct Slice {
-    char const* start;
-    char const* end;
-};
+auto http::detail::set_header(HeaderContainer& headers,
+                             char const* name,
+                             std::string value) -> void
+{
+    auto it = find_header(headers, name);
+    if (it == headers.end()) {
+        headers.emplace_back(name, std::move(value));
+        return;
+    }
 
-struct ParsedRequestData {
-    using Header = std::pair<Slice, Slice>;
-    using HeaderContainer = std::vector<Header>;
+    auto const n = static_cast<size_t>(it - headers.cbegin());
+    std::get<1>(headers[n]) = std::move(value);
 
-    ParsedRequestData() :
-        path { nullptr, nullptr }
-    ,   headers { }
-    {
-        headers.reserve(32);
+    headers.erase(
+        std::remove_if(
+            headers.begin() + n + 1,
+            headers.end(),
+            [&](auto const& h) { return iequals(std::get<0>(h), name); }),
+        headers.end());
+}
+
+auto http::detail::remove_header(HeaderContainer& headers, 
+                                 char const* name) noexcept -> size_t
+{
+    auto it = std::remove_if(
+        headers.begin(),
+        headers.end(),
+        [&](auto const& h) { return iequals(std::get<0>(h), name); });
+
+    auto const n = static_cast<size_t>(headers.end() - it);
+    headers.erase(it, headers.end());
+    return n;
+}
+
+auto http::detail::update_content_length(HeaderContainer& headers,
+                                         size_t size) -> void
+{
+    for (auto& h : headers) {
+        if (iequals(std::get<0>(h), "Content-Length")) {
+            std::get<1>(h) = std::to_string(size);
+        }
     }
+}
 
-    Slice path;
-    HeaderContainer headers;
-    std::vector<Slice> body_chunks;
-};
+constexpr size_t ParseDiagnostics::EXCERPT_CONTEXT;
 
-struct ParsedResponseData {
-    using Header = std::pair<Slice, Slice>;
-    using HeaderContainer = std::vector<Header>;
+namespace {
+
+    struct Slice {
+        char const* start;
+        char const* end;
+    };
 
-    ParsedResponseData() :
-        status_text { nullptr, nullptr }
-    ,   headers { }
-    ,   body_chunks { }
+    // Copies the `size` bytes described by `chunks` into a body of their
+    // own, one `memcpy` per chunk...
+    auto assemble_body(std::vector<Slice> const& chunks, 
+                       size_t size,
+                       ParseOptions const& options) noexcept
+        -> result::Result<Body, std::error_code>
     {
-        headers.reserve(32);
+        if (size > options.body_spill_threshold) {
+            auto file = MappedFile::create_temporary(size);
+            if (!file) {
+                return result::err(result::error(std::move(file)));
+            }
+
+            auto mapped = result::value(std::move(file));
+            auto* out = mapped.data();
+            for (auto const& ch : chunks) {
+                assert(ch.start != nullptr);
+                assert(ch.end != nullptr);
+                std::memcpy(out, ch.start, ch.end - ch.start);
+                out += (ch.end - ch.start);
+            }
+
+            return result::ok(Body { std::move(mapped) });
+        }
+
+        auto body = BodyContainer { };
+        body.reserve(size);
+
+        for (auto const& ch : chunks) {
+            assert(ch.start != nullptr);
+            assert(ch.end != nullptr);
+            auto const* p = reinterpret_cast<uint8_t const*>(ch.start);
+            body.insert(body.end(), p, p + (ch.end - ch.start));
+        }
+
+        assert(body.size() == size);
+        return result::ok(Body { std::move(body) });
     }
 
-    Slice status_text;
-    HeaderContainer headers;
-    std::vector<Slice> body_chunks;
-};
+    // Moves the `size` bytes described by `chunks` together, over whatever
+    // separates them (i.e. chunk delimiters), and returns a view of the
+    // result. `chunks` must be in order, and point into a mutable buffer...
+    auto compact_body(std::vector<Slice> const& chunks, size_t size) noexcept
+        -> Body
+    {
+        if (chunks.empty()) {
+            return Body { };
+        }
 
-auto http::detail::parse_request(char const* bytes, size_t size) noexcept
-    -> ParseResult<std::pair<HttpRequest, size_t>>
-{
-        parser::http_parser parser;
-        parser::http_parser_settings parser_settings;
-        parser::http_parser_init(&parser, parser::HTTP_REQUEST);
-        parser::http_parser_settings_init(&parser_settings);
-
-        parser_settings.on_header_field = 
-            [](auto* parser, auto const* data, auto len) -> int {
-                auto& pd = *reinterpret_cast<ParsedRequestData*>(parser->data);
-                pd.headers.emplace_back(
-                    Slice { data, data + len }, 
-                    Slice { nullptr, nullptr });
-
-                return 0;
-            };
-
-        parser_settings.on_header_value = 
-            [](auto* parser, auto const* data, auto len) -> int {
-                auto& pd = *reinterpret_cast<ParsedRequestData*>(parser->data);
-                std::get<1>(pd.headers.back()) = 
-                    Slice { data, data + len };
-
-                return 0;
-            };
-
-        parser_settings.on_url =
-            [](auto* parser, auto const* data, auto len) -> int {
-                auto& pd = *reinterpret_cast<ParsedRequestData*>(parser->data);
-                pd.path = Slice { data, data + len };
-                return 0;
-            };
-
-        parser_settings.on_body =
-            [](auto* parser, auto const* data, auto len) -> int {
-                auto& pd = *reinterpret_cast<ParsedRequestData*>(parser->data);
-                pd.body_chunks.push_back({ data, data + len });
-                return 0;
-            };
-
-        auto data = ParsedRequestData { };
-        parser.data = &data;
-
-        auto parsed_len = http_parser_execute(&parser, 
-                                              &parser_settings,
-                                              bytes,
-                                              size);
-
-        // We need to call `http_parser_execute` twice to force the parser
-        // to tell us if `data` contains a complete HTTP object or not.
-        // Without this call, the parser won't return an error because it
-        // thinks more data will follow.
-        //
-        // From [http-parser's README][1]:
-        // > To tell `http_parser` about EOF, give `0` as the fourth 
-        // > parameter to `http_parser_execute()`
-        //
-        // [1]: https://github.com/nodejs/http-parser
-        http_parser_execute(&parser, 
-                            &parser_settings,
-                            bytes + size,
-                            0);
-
-        if (parser.http_errno) {
+        auto* const first = const_cast<char*>(chunks.front().start);
+        auto* out = first;
+        for (auto const& ch : chunks) {
+            auto const n = static_cast<size_t>(ch.end - ch.start);
+            if (out != ch.start) {
+                std::memmove(out, ch.start, n);
+            }
+
+            out += n;
+        }
+
+        assert(static_cast<size_t>(out - first) == size);
+        return Body::view(reinterpret_cast<uint8_t const*>(first), size);
+    }
+
+    auto trim(Slice s) noexcept -> Slice {
+        while (s.start != s.end && (*s.start == ' ' || *s.start == '\t')) {
+            ++s.start;
+        }
+
+        while (s.end != s.start && (*(s.end-1) == ' ' || *(s.end-1) == '\t')) {
+            --s.end;
+        }
+
+        return s;
+    }
+
+    auto iequals(Slice s, char const* rhs) noexcept -> bool {
+        return detail::iequals(s.start,
+                               s.end,
+                               rhs,
+                               rhs + std::char_traits<char>::length(rhs));
+    }
+
+    // Inflates bodies sent with `Content-Encoding: gzip` or `deflate` as they
+    // are parsed, when `ParseOptions::decode_content_encoding` is set...
+    struct ContentDecoding {
+        enum class Status {
+            Passthrough,
+            Decoded,
+            Failed,
+        };
+
+        explicit ContentDecoding(ParseOptions const& options) :
+            enabled { options.decode_content_encoding }
+        ,   checked { false }
+        ,   max_size { options.max_body_size }
+        ,   spill_threshold { options.body_spill_threshold }
+        ,   content_encoding { nullptr, nullptr }
+        ,   at_content_encoding { false }
+        ,   spilled { 0 }
+        { }
+
+        // Called for every header, whatever is being captured, so that the
+        // `Content-Encoding` is known even when the headers aren't kept. The
+        // first one wins...
+        auto header_field(Slice field) noexcept -> void {
+            at_content_encoding = !content_encoding.start &&
+                iequals(field, "Content-Encoding");
+        }
+
+        auto header_value(Slice value) noexcept -> void {
+            if (at_content_encoding) {
+                content_encoding = value;
+                at_content_encoding = false;
+            }
+        }
+
+        auto decode(char const* data, size_t len) -> Status {
+            if (!checked) {
+                checked = true;
+                if (!start()) {
+                    return Status::Failed;
+                }
+            }
+
+#ifdef HTTP_HAS_ZLIB
+            if (!decoder) {
+                return Status::Passthrough;
+            }
+
+            constexpr size_t MIN_ROOM = 16 * 1024;
+
+            auto const* in = reinterpret_cast<uint8_t const*>(data);
+            while (len) {
+                if (decoder->is_finished() && !next_member()) {
+                    return Status::Failed;
+                }
+
+                // Never grow past one byte more than the limit, so that a
+                // small, highly compressed body can't exhaust memory before
+                // the limit is noticed...
+                auto const old_size = decoded.size();
+                auto room = std::max(MIN_ROOM, old_size);
+                if (max_size - size() < room) {
+                    room = max_size - size() + 1;
+                }
+
+                decoded.resize(old_size + room);
+
+                auto consumed = static_cast<size_t>(0);
+                auto r = decoder->decode(in,
+                                         len,
+                                         consumed,
+                                         decoded.data() + old_size,
+                                         decoded.size() - old_size);
+                if (!r) {
+                    error = result::error(std::move(r));
+                    return Status::Failed;
+                }
+
+                auto const written = result::value(std::move(r));
+                decoded.resize(old_size + written);
+
+                if (size() > max_size) {
+                    error = make_error_code(ParseError::BODY_TOO_LARGE);
+                    return Status::Failed;
+                }
+
+                if (!spill()) {
+                    return Status::Failed;
+                }
+
+                in += consumed;
+                len -= consumed;
+
+                if (!consumed && !written) {
+                    break;
+                }
+            }
+
+            return Status::Decoded;
+#else
+            (void)data;
+            (void)len;
+            return Status::Passthrough;
+#endif
+        }
+
+        inline auto is_active() const noexcept -> bool {
+#ifdef HTTP_HAS_ZLIB
+            return decoder != nullptr;
+#else
+            return false;
+#endif
+        }
+
+        inline auto is_complete() const noexcept -> bool {
+#ifdef HTTP_HAS_ZLIB
+            return !decoder || decoder->is_finished();
+#else
+            return true;
+#endif
+        }
+
+        // The size of the decoded body so far...
+        inline auto size() const noexcept -> size_t
+        { return spilled + decoded.size(); }
+
+        bool enabled;
+        bool checked;
+        size_t max_size;
+        size_t spill_threshold;
+        Slice content_encoding;
+        bool at_content_encoding;
+        std::error_code error;
+
+        // The decoded body. Once it grows past `spill_threshold`, it is
+        // moved into `spill_file` as it is decoded, and `decoded` only holds
+        // the latest output...
+        BodyContainer decoded;
+        TemporaryFile spill_file;
+        size_t spilled;
+
+    private:
+        auto spill() noexcept -> bool {
+            if (!spill_file.is_open()) {
+                if (size() <= spill_threshold) {
+                    return true;
+                }
+
+                auto file = TemporaryFile::create();
+                if (!file) {
+                    error = result::error(std::move(file));
+                    return false;
+                }
+
+                spill_file = result::value(std::move(file));
+            }
+
+            error = spill_file.write(decoded.data(), decoded.size());
+            if (error) {
+                return false;
+            }
+
+            spilled += decoded.size();
+            decoded.clear();
+            return true;
+        }
+
+        auto start() -> bool {
+            auto value = trim(content_encoding);
+            if (value.start == value.end || iequals(value, "identity")) {
+                return true;
+            }
+
+#ifdef HTTP_HAS_ZLIB
+            if (iequals(value, "gzip") || iequals(value, "x-gzip")) {
+                return start_decoder(ContentCoding::Gzip);
+            }
+
+            if (iequals(value, "deflate")) {
+                return start_decoder(ContentCoding::Deflate);
+            }
+#endif
+
+            error = make_error_code(ParseError::UNSUPPORTED_CONTENT_ENCODING);
+            return false;
+        }
+
+#ifdef HTTP_HAS_ZLIB
+        auto start_decoder(ContentCoding c) -> bool {
+            auto d = Decoder::create(c);
+            if (!d) {
+                error = result::error(std::move(d));
+                return false;
+            }
+
+            decoder = std::make_unique<Decoder>(result::value(std::move(d)));
+            coding = c;
+            return true;
+        }
+
+        // More data follows the end of the compressed stream. A gzip body
+        // may hold several members, decoded one after another (RFC 1952,
+        // section 2.2); anything else is an error...
+        auto next_member() noexcept -> bool {
+            if (coding != ContentCoding::Gzip) {
+                error = make_error_code(ParseError::INVALID_CONTENT_ENCODING);
+                return false;
+            }
+
+            error = decoder->reset();
+            return !error;
+        }
+
+        std::unique_ptr<Decoder> decoder;
+        ContentCoding coding;
+#endif
+    };
+
+    // Replaces the body described by `chunks` with the decoded one, and
+    // updates the headers to match...
+    auto finish_decoding(ContentDecoding& decoding,
+                         HeaderContainer& headers) noexcept
+        -> result::Result<Body, std::error_code>
+    {
+        if (!decoding.is_complete()) {
             return result::err(
-                make_error_code(static_cast<ParseError>(parser.http_errno)));
+                make_error_code(ParseError::INVALID_CONTENT_ENCODING));
+        }
+
+        detail::remove_header(headers, "Content-Encoding");
+        detail::update_content_length(headers, decoding.size());
+
+        if (decoding.spill_file.is_open()) {
+            auto file = std::move(decoding.spill_file).map();
+            if (!file) {
+                return result::err(result::error(std::move(file)));
+            }
+
+            return result::ok(Body { result::value(std::move(file)) });
+        }
+
+        return result::ok(Body { std::move(decoding.decoded) });
+    }
+
+    // The parts of a request being parsed. Only the parts in `C` are
+    // collected (see the callbacks below), so the others never allocate...
+    template<Capture C>
+    struct ParsedRequestData {
+        using Header = std::pair<Slice, Slice>;
+        using HeaderContainer = std::vector<Header>;
+
+        static constexpr Capture CAPTURE = C;
+
+        explicit ParsedRequestData(ParseOptions const& options) :
+            options { options }
+        ,   path { nullptr, nullptr }
+        ,   headers { }
+        ,   header_count { 0 }
+        ,   header_bytes { 0 }
+        ,   body_bytes { 0 }
+        ,   decoding { options }
+        {
+            if (detail::captures(C, Capture::Headers)) {
+                headers.reserve(std::min(options.max_header_count, 
+                                         static_cast<size_t>(32)));
+            }
+        }
+
+        // Prepares for another message, keeping the capacity that has
+        // already been allocated...
+        auto reset() -> void {
+            path = Slice { nullptr, nullptr };
+            headers.clear();
+            header_count = 0;
+            header_bytes = 0;
+            body_chunks.clear();
+            body_bytes = 0;
+            decoding = ContentDecoding { options };
+            error = std::error_code { };
+        }
+
+        ParseOptions const& options;
+        Slice path;
+        HeaderContainer headers;
+        size_t header_count;
+        size_t header_bytes;
+        std::vector<Slice> body_chunks;
+        size_t body_bytes;
+        ContentDecoding decoding;
+        std::error_code error;
+    };
+
+    struct ParsedResponseData {
+        using Header = std::pair<Slice, Slice>;
+        using HeaderContainer = std::vector<Header>;
+
+        static constexpr Capture CAPTURE = Capture::All;
+
+        explicit ParsedResponseData(ParseOptions const& options) :
+            options { options }
+        ,   status_text { nullptr, nullptr }
+        ,   headers { }
+        ,   header_count { 0 }
+        ,   header_bytes { 0 }
+        ,   body_chunks { }
+        ,   body_bytes { 0 }
+        ,   decoding { options }
+        {
+            headers.reserve(std::min(options.max_header_count, 
+                                     static_cast<size_t>(32)));
+        }
+
+        ParseOptions const& options;
+        Slice status_text;
+        HeaderContainer headers;
+        size_t header_count;
+        size_t header_bytes;
+        std::vector<Slice> body_chunks;
+        size_t body_bytes;
+        ContentDecoding decoding;
+        std::error_code error;
+    };
+
+    // Records why a callback is stopping the parse. Returning nonzero from a
+    // callback makes http-parser stop immediately, with `HPE_CB_*`...
+    template<typename Data>
+    auto fail_parse(Data& pd, ParseError e) noexcept -> int {
+        pd.error = make_error_code(e);
+        return 1;
+    }
+
+    // The limit checks shared by the request and response callbacks. Each
+    // returns nonzero if the message should be rejected...
+    template<typename Data>
+    auto check_header_value(Data& pd, size_t len) noexcept -> int {
+        pd.header_bytes += len;
+        if (pd.header_bytes > pd.options.max_header_bytes) {
+            return fail_parse(pd, ParseError::HEADERS_TOO_LARGE);
         }
 
-        assert(parsed_len);
-        assert(parser.method >= 0);
+        return 0;
+    }
 
-        if (parser.method > static_cast<int>(Method::Trace)) {
-            return result::err(make_error_code(ParseError::INVALID_METHOD));
+    template<typename Data>
+    auto check_header_field(Data& pd, size_t len) noexcept -> int {
+        if (pd.header_count >= pd.options.max_header_count) {
+            return fail_parse(pd, ParseError::TOO_MANY_HEADERS);
         }
 
-        auto hdrs = std::vector<Header> { };
-        hdrs.reserve(data.headers.size());
+        ++pd.header_count;
+
+        return check_header_value(pd, len);
+    }
+
+    template<typename Data>
+    auto check_body(Data& pd, size_t len) noexcept -> int {
+        pd.body_bytes += len;
+        if (pd.body_bytes > pd.options.max_body_size) {
+            return fail_parse(pd, ParseError::BODY_TOO_LARGE);
+        }
 
-        std::transform(
-            data.headers.begin(), 
-            data.headers.end(),
-            std::back_inserter(hdrs),
-            [](auto h) {
-                assert(std::get<0>(h).end >= std::get<0>(h).start);
-                assert(std::get<1>(h).end >= std::get<1>(h).start);
+        return 0;
+    }
+
+    // Produces the body of a parsed message. `in_place` means the input is
+    // mutable, so the body can be compacted in place rather than copied...
+    template<typename Data>
+    auto make_body(Data& pd, HeaderContainer& headers, bool in_place) noexcept
+        -> result::Result<Body, std::error_code>
+    {
+        if (!detail::captures(Data::CAPTURE, Capture::Body)) {
+            return result::ok(Body { });
+        }
+
+        if (pd.decoding.is_active()) {
+            return finish_decoding(pd.decoding, headers);
+        }
+
+        if (in_place) {
+            return result::ok(compact_body(pd.body_chunks, pd.body_bytes));
+        }
+
+        return assemble_body(pd.body_chunks, pd.body_bytes, pd.options);
+    }
+
+    // Returns the part of the message that `offset` falls in...
+    auto phase_at(char const* bytes, size_t offset) noexcept -> char const* {
+        auto const* end = bytes + offset;
+        auto const* p = std::find(bytes, end, '\n');
+        if (p == end) {
+            return "start-line";
+        }
 
-                return std::make_pair(
-                    std::string { std::get<0>(h).start, std::get<0>(h).end },
-                    std::string { std::get<1>(h).start, std::get<1>(h).end });
-            });
+        // The head ends at the first empty line...
+        ++p;
+        while (p != end) {
+            auto const* eol = std::find(p, end, '\n');
+            if (eol == end) {
+                break;
+            }
 
-        auto body = std::vector<uint8_t> { };
+            if (eol == p || (eol == p + 1 && *p == '\r')) {
+                return "body";
+            }
 
-        body.reserve(
-            std::accumulate(data.body_chunks.begin(),
-                    data.body_chunks.end(),
-                    static_cast<size_t>(0),
-                    [](auto const& acc, auto const& item) {
-                        return acc + (item.end - item.start);
+            p = eol + 1;
+        }
+
+        return "headers";
+    }
+
+    auto append_escaped(std::string& out, char c) -> void {
+        constexpr char HEX[] = "0123456789abcdef";
+
+        switch (c) {
+            case '\r': out += "\\r"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            case '\\': out += "\\\\"; break;
+            default:
+                if (c >= 0x20 && c < 0x7f) {
+                    out += c;
+                }
+                else {
+                    auto const b = static_cast<unsigned char>(c);
+                    out += "\\x";
+                    out += HEX[b >> 4];
+                    out += HEX[b & 0xf];
+                }
+        }
+    }
+
+    // Every failed parse comes through here, so counting and describing the
+    // failure costs nothing when parsing succeeds...
+    auto parse_failed(std::error_code ec,
+                      char const* bytes,
+                      size_t size,
+                      size_t offset,
+                      ParseOptions const& options) -> std::error_code
+    {
+        detail::count_parse_error(ec);
+
+        auto* d = options.diagnostics;
+        if (!d) {
+            return ec;
+        }
+
+        offset = std::min(offset, size);
+
+        auto const* line_start = bytes;
+        d->line = 1;
+        for (auto const* p = bytes; p != bytes + offset; ++p) {
+            if (*p == '\n') {
+                ++d->line;
+                line_start = p + 1;
+            }
+        }
+
+        d->error = ec;
+        d->offset = offset;
+        d->column = static_cast<size_t>(bytes + offset - line_start) + 1;
+        d->phase = phase_at(bytes, offset);
+        d->byte = offset < size 
+            ? static_cast<unsigned char>(bytes[offset]) 
+            : -1;
+
+        auto const first = offset - std::min(offset, 
+                                             ParseDiagnostics::EXCERPT_CONTEXT);
+        auto const last = offset + std::min(size - offset, 
+                                            ParseDiagnostics::EXCERPT_CONTEXT);
+
+        d->excerpt.clear();
+        for (auto i = first; i != last; ++i) {
+            append_escaped(d->excerpt, bytes[i]);
+        }
+
+        return ec;
+    }
+
+    // The parser callbacks. They are plain functions rather than lambdas so
+    // that the settings tables below can be constant-initialized, rather
+    // than built on every parse...
+    template<typename Data>
+    auto on_header_field(parser::http_parser* parser, 
+                         char const* data, 
+                         size_t len) -> int
+    {
+        auto& pd = *reinterpret_cast<Data*>(parser->data);
+        if (check_header_field(pd, len)) {
+            return 1;
+        }
+
+        if (detail::captures(Data::CAPTURE, Capture::Body) &&
+            pd.decoding.enabled)
+        {
+            pd.decoding.header_field(Slice { data, data + len });
+        }
+
+        if (!detail::captures(Data::CAPTURE, Capture::Headers)) {
+            return 0;
+        }
+
+        pd.headers.emplace_back(
+            Slice { data, data + len }, 
+            Slice { nullptr, nullptr });
+
+        return 0;
+    }
+
+    template<typename Data>
+    auto on_header_value(parser::http_parser* parser, 
+                         char const* data, 
+                         size_t len) -> int
+    {
+        auto& pd = *reinterpret_cast<Data*>(parser->data);
+        if (check_header_value(pd, len)) {
+            return 1;
+        }
+
+        if (detail::captures(Data::CAPTURE, Capture::Body) &&
+            pd.decoding.enabled)
+        {
+            pd.decoding.header_value(Slice { data, data + len });
+        }
+
+        if (!detail::captures(Data::CAPTURE, Capture::Headers)) {
+            return 0;
+        }
+
+        std::get<1>(pd.headers.back()) = 
+            Slice { data, data + len };
+
+        return 0;
+    }
+
+    template<typename Data>
+    auto on_body(parser::http_parser* parser, 
+                 char const* data, 
+                 size_t len) -> int
+    {
+        auto& pd = *reinterpret_cast<Data*>(parser->data);
+        if (check_body(pd, len)) {
+            return 1;
+        }
+
+        if (!detail::captures(Data::CAPTURE, Capture::Body)) {
+            return 0;
+        }
+
+        if (pd.decoding.enabled) {
+            switch (pd.decoding.decode(data, len)) {
+                case ContentDecoding::Status::Decoded:
+                    return 0;
+                case ContentDecoding::Status::Failed:
+                    return 1;
+                default:
+                    break;
+            }
+        }
+
+        pd.body_chunks.push_back({ data, data + len });
+        return 0;
+    }
+
+    template<typename Data>
+    auto on_url(parser::http_parser* parser, 
+                char const* data, 
+                size_t len) -> int
+    {
+        auto& pd = *reinterpret_cast<Data*>(parser->data);
+        if (len > pd.options.max_url_length) {
+            return fail_parse(pd, ParseError::URL_TOO_LONG);
+        }
+
+        if (!detail::captures(Data::CAPTURE, Capture::Path)) {
+            return 0;
+        }
+
+        pd.path = Slice { data, data + len };
+        return 0;
+    }
+
+    auto on_status(parser::http_parser* parser, 
+                   char const* data, 
+                   size_t len) -> int
+    {
+        auto& pd = *reinterpret_cast<ParsedResponseData*>(parser->data);
+        pd.status_text = Slice { data, data + len };
+        return 0;
+    }
+
+    // Stops the parser at the end of the message, so that it doesn't go on
+    // to parse the next one (of a pipeline) into the same data...
+    auto on_message_complete(parser::http_parser* parser) -> int {
+        parser::http_parser_pause(parser, 1);
+        return 0;
+    }
+
+    // In the field order of `http_parser_settings`. There is one table per
+    // capture profile, so each profile's callbacks are specialized for it...
+    template<Capture C>
+    constexpr parser::http_parser_settings REQUEST_SETTINGS = {
+        nullptr,                                    // on_message_begin
+        &on_url<ParsedRequestData<C>>,              // on_url
+        nullptr,                                    // on_status
+        &on_header_field<ParsedRequestData<C>>,     // on_header_field
+        &on_header_value<ParsedRequestData<C>>,     // on_header_value
+        nullptr,                                    // on_headers_complete
+        &on_body<ParsedRequestData<C>>,             // on_body
+        &on_message_complete,                       // on_message_complete
+        nullptr,                                    // on_chunk_header
+        nullptr,                                    // on_chunk_complete
+    };
+
+    constexpr parser::http_parser_settings RESPONSE_SETTINGS = {
+        nullptr,                                // on_message_begin
+        nullptr,                                // on_url
+        &on_status,                             // on_status
+        &on_header_field<ParsedResponseData>,   // on_header_field
+        &on_header_value<ParsedResponseData>,   // on_header_value
+        nullptr,                                // on_headers_complete
+        &on_body<ParsedResponseData>,           // on_body
+        &on_message_complete,                   // on_message_complete
+        nullptr,                                // on_chunk_header
+        nullptr,                                // on_chunk_complete
+    };
+
+    // Rejects options this platform can't honour. Spilling bodies needs
+    // `MappedFile`, which is only implemented for POSIX systems...
+    auto check_options(ParseOptions const& options) noexcept
+        -> std::error_code
+    {
+#ifdef _WIN32
+        constexpr auto NEVER = std::numeric_limits<size_t>::max();
+        if (options.body_spill_threshold != NEVER) {
+            return std::make_error_code(std::errc::not_supported);
+        }
+#else
+        (void)options;
+#endif
+
+        return { };
+    }
+
+    // Parses a single request from `bytes`, using `data` to collect its
+    // parts. `data` must be fresh, or `reset()`...
+    template<Capture C>
+    auto execute_request(ParsedRequestData<C>& data,
+                         char const* bytes,
+                         size_t size,
+                         bool in_place) noexcept
+        -> ParseResult<std::pair<HttpRequest, size_t>>
+    {
+            auto const& parser_settings = REQUEST_SETTINGS<C>;
+            auto const& options = data.options;
+
+            if (auto ec = check_options(options)) {
+                return result::err(parse_failed(ec, bytes, size, 0, options));
+            }
+
+            parser::http_parser parser;
+            parser::http_parser_init(&parser, parser::HTTP_REQUEST);
+            parser.data = &data;
+
+            auto parsed_len = http_parser_execute(&parser, 
+                                                  &parser_settings,
+                                                  bytes,
+                                                  size);
+
+            // We need to call `http_parser_execute` twice to force the parser
+            // to tell us if `data` contains a complete HTTP object or not.
+            // Without this call, the parser won't return an error because it
+            // thinks more data will follow.
+            //
+            // From [http-parser's README][1]:
+            // > To tell `http_parser` about EOF, give `0` as the fourth 
+            // > parameter to `http_parser_execute()`
+            //
+            // [1]: https://github.com/nodejs/http-parser
+            //
+            // If the message is already complete, the parser is paused (see
+            // `on_message_complete`), and this does nothing.
+            http_parser_execute(&parser, 
+                                &parser_settings,
+                                bytes + size,
+                                0);
+
+            if (parser.http_errno &&
+                parser.http_errno != parser::HPE_PAUSED)
+            {
+                auto ec = data.error 
+                    ? data.error
+                    : data.decoding.error 
+                        ? data.decoding.error
+                        : make_error_code(
+                              static_cast<ParseError>(parser.http_errno));
+
+                return result::err(
+                    parse_failed(ec, bytes, size, parsed_len, options));
+            }
+
+            assert(parsed_len);
+            assert(parser.method >= 0);
+
+            if (parser.method > static_cast<int>(Method::Trace)) {
+                return result::err(
+                    parse_failed(make_error_code(ParseError::INVALID_METHOD),
+                                 bytes,
+                                 size,
+                                 0,
+                                 options));
+            }
+
+            auto hdrs = std::vector<Header> { };
+            hdrs.reserve(data.headers.size());
+
+            std::transform(
+                data.headers.begin(), 
+                data.headers.end(),
+                std::back_inserter(hdrs),
+                [](auto h) {
+                    assert(std::get<0>(h).end >= std::get<0>(h).start);
+                    assert(std::get<1>(h).end >= std::get<1>(h).start);
+
+                    auto const& name = std::get<0>(h);
+                    auto const& value = std::get<1>(h);
+                    return std::make_pair(
+                        std::string { name.start, name.end },
+                        std::string { value.start, value.end });
+                });
+
+            auto body = make_body(data, hdrs, in_place);
+            if (!body) {
+                return result::err(parse_failed(result::error(std::move(body)),
+                                                bytes,
+                                                size,
+                                                parsed_len,
+                                                options));
+            }
+
+            return result::ok(std::make_pair(
+                HttpRequestBuilder { }
+                    .with_protocol({ 
+                        static_cast<Method>(parser.method), 
+                        std::string { data.path.start, data.path.end },
+                        Version::Http11 
                     })
-        );
+                    .with_headers(std::move(hdrs))
+                    .with_upgrade(parser.upgrade)
+                    .build(result::value(std::move(body))),
+                parsed_len
+            ));
 
-        std::for_each(
-            data.body_chunks.begin(),
-            data.body_chunks.end(),
-            [&](auto ch) {
-                assert(ch.start != nullptr);
-                assert(ch.end != nullptr);
-                std::copy(
-                    ch.start,
-                    ch.end,
-                    std::back_inserter(body)
-                );
-            });
-
-        return result::ok(std::make_pair(
-            HttpRequestBuilder { }
-                .with_protocol({ 
-                    static_cast<Method>(parser.method), 
-                    std::string { data.path.start, data.path.end },
-                    Version::Http11 
-                })
-                .with_headers(std::move(hdrs))
-                .build(std::move(body)),
-            parsed_len
-        ));
+    }
 
 }
 
-auto http::detail::parse_response(char const* bytes, size_t size) noexcept
-    -> ParseResult<std::pair<HttpResponse, size_t>>
+template<Capture C>
+auto http::detail::parse_request(char const* bytes, 
+                                 size_t size,
+                                 ParseOptions const& options) noexcept
+    -> ParseResult<std::pair<HttpRequest, size_t>>
 {
-        parser::http_parser parser;
-        parser::http_parser_settings parser_settings;
-        parser::http_parser_init(&parser, parser::HTTP_RESPONSE);
-        parser::http_parser_settings_init(&parser_settings);
-
-        parser_settings.on_header_field = 
-            [](auto* parser, auto const* data, auto len) -> int {
-                auto& pd = *reinterpret_cast<ParsedResponseData*>(parser->data);
-                pd.headers.emplace_back(
-                    Slice { data, data + len }, 
-                    Slice { nullptr, nullptr });
-
-                return 0;
-            };
-
-        parser_settings.on_header_value = 
-            [](auto* parser, auto const* data, auto len) -> int {
-                auto& pd = *reinterpret_cast<ParsedResponseData*>(parser->data);
-                std::get<1>(pd.headers.back()) = 
-                    Slice { data, data + len };
-
-                return 0;
-            };
-
-        parser_settings.on_status =
-            [](auto* parser, auto const* data, auto len) -> int {
-                auto& pd = *reinterpret_cast<ParsedResponseData*>(parser->data);
-                pd.status_text = Slice { data, data + len };
-                return 0;
-            };
-
-        parser_settings.on_body =
-            [](auto* parser, auto const* data, auto len) -> int {
-                auto& pd = *reinterpret_cast<ParsedResponseData*>(parser->data);
-                pd.body_chunks.push_back({ data, data + len });
-                return 0;
-            };
-
-        auto data = ParsedResponseData { };
-        parser.data = &data;
-
-        auto parsed_len = http_parser_execute(&parser, 
-                                              &parser_settings,
-                                              bytes,
-                                              size);
-
-        // We need to call `http_parser_execute` twice to force the parser
-        // to tell us if `data` contains a complete HTTP object or not.
-        // Without this call, the parser won't return an error because it
-        // thinks more data will follow.
-        //
-        // From [http-parser's README][1]:
-        // > To tell `http_parser` about EOF, give `0` as the fourth 
-        // > parameter to `http_parser_execute()`
-        //
-        // [1]: https://github.com/nodejs/http-parser
-        http_parser_execute(&parser, 
-                            &parser_settings,
-                            bytes + size,
-                            0);
-
-        if (parser.http_errno) {
-            return result::err(
-                make_error_code(static_cast<ParseError>(parser.http_errno)));
+    auto data = ParsedRequestData<C> { options };
+    return execute_request(data, bytes, size, false);
+}
+
+template auto http::detail::parse_request<Capture::None>(
+    char const*, size_t, ParseOptions const&) noexcept
+    -> ParseResult<std::pair<HttpRequest, size_t>>;
+template auto http::detail::parse_request<Capture::Path>(
+    char const*, size_t, ParseOptions const&) noexcept
+    -> ParseResult<std::pair<HttpRequest, size_t>>;
+template auto http::detail::parse_request<Capture::Headers>(
+    char const*, size_t, ParseOptions const&) noexcept
+    -> ParseResult<std::pair<HttpRequest, size_t>>;
+template auto http::detail::parse_request<Capture::Path | Capture::Headers>(
+    char const*, size_t, ParseOptions const&) noexcept
+    -> ParseResult<std::pair<HttpRequest, size_t>>;
+template auto http::detail::parse_request<Capture::Body>(
+    char const*, size_t, ParseOptions const&) noexcept
+    -> ParseResult<std::pair<HttpRequest, size_t>>;
+template auto http::detail::parse_request<Capture::Path | Capture::Body>(
+    char const*, size_t, ParseOptions const&) noexcept
+    -> ParseResult<std::pair<HttpRequest, size_t>>;
+template auto http::detail::parse_request<Capture::Headers | Capture::Body>(
+    char const*, size_t, ParseOptions const&) noexcept
+    -> ParseResult<std::pair<HttpRequest, size_t>>;
+template auto http::detail::parse_request<Capture::All>(
+    char const*, size_t, ParseOptions const&) noexcept
+    -> ParseResult<std::pair<HttpRequest, size_t>>;
+
+auto http::detail::parse_request_in_place(char* bytes, 
+                                          size_t size,
+                                          ParseOptions const& options) noexcept
+    -> ParseResult<std::pair<HttpRequest, size_t>>
+{
+    auto data = ParsedRequestData<Capture::All> { options };
+    return execute_request(data, bytes, size, true);
+}
+
+namespace {
+
+    // Hints to the CPU that `p` will be read soon...
+    inline auto prefetch(void const* p) noexcept -> void {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(p, 0, 3);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        _mm_prefetch(static_cast<char const*>(p), _MM_HINT_T0);
+#else
+        (void)p;
+#endif
+    }
+
+    // Prefetches the start of a job's buffer; the request line and first
+    // headers are what the parser reads first...
+    auto prefetch_job(ParseJob const& job) noexcept -> void {
+        constexpr size_t CACHE_LINE = 64;
+        constexpr size_t PREFETCH_BYTES = 4 * CACHE_LINE;
+
+        auto const n = std::min(job.size, PREFETCH_BYTES);
+        for (size_t offset = 0; offset < n; offset += CACHE_LINE) {
+            prefetch(job.data + offset);
         }
+    }
+
+}
+
+auto http::parse_requests(ParseJob const* jobs,
+                          size_t count,
+                          std::vector<ParseResult<
+                              std::pair<HttpRequest, size_t>>>& results,
+                          ParseOptions const& options) -> void
+{
+    // How many jobs ahead to prefetch. The buffers come from different
+    // connections, so they are scattered and probably cold...
+    constexpr size_t PREFETCH_DISTANCE = 2;
+
+    results.reserve(results.size() + count);
+
+    for (size_t i = 0; i < std::min(count, PREFETCH_DISTANCE); ++i) {
+        prefetch_job(jobs[i]);
+    }
+
+    auto data = ParsedRequestData<Capture::All> { options };
+    for (size_t i = 0; i < count; ++i) {
+        if (i + PREFETCH_DISTANCE < count) {
+            prefetch_job(jobs[i + PREFETCH_DISTANCE]);
+        }
+
+        data.reset();
+        results.push_back(
+            execute_request(data, jobs[i].data, jobs[i].size, false));
+    }
+}
+
+namespace {
+
+    // Parses a single response from `bytes`...
+    auto execute_response(char const* bytes,
+                          size_t size,
+                          ParseOptions const& options,
+                          bool in_place) noexcept
+        -> ParseResult<std::pair<HttpResponse, size_t>>
+    {
+            auto const& parser_settings = RESPONSE_SETTINGS;
+
+            if (auto ec = check_options(options)) {
+                return result::err(parse_failed(ec, bytes, size, 0, options));
+            }
 
-        assert(parsed_len);
+            parser::http_parser parser;
+            parser::http_parser_init(&parser, parser::HTTP_RESPONSE);
 
-        auto hdrs = std::vector<Header> { };
-        hdrs.reserve(data.headers.size());
+            auto data = ParsedResponseData { options };
+            parser.data = &data;
 
-        std::transform(
-            data.headers.begin(), 
-            data.headers.end(),
-            std::back_inserter(hdrs),
-            [](auto h) {
-                assert(std::get<0>(h).end >= std::get<0>(h).start);
-                assert(std::get<1>(h).end >= std::get<1>(h).start);
+            auto parsed_len = http_parser_execute(&parser, 
+                                                  &parser_settings,
+                                                  bytes,
+                                                  size);
 
-                return std::make_pair(
-                    std::string { std::get<0>(h).start, std::get<0>(h).end },
-                    std::string { std::get<1>(h).start, std::get<1>(h).end });
-            });
+            // We need to call `http_parser_execute` twice to force the parser
+            // to tell us if `data` contains a complete HTTP object or not.
+            // Without this call, the parser won't return an error because it
+            // thinks more data will follow.
+            //
+            // From [http-parser's README][1]:
+            // > To tell `http_parser` about EOF, give `0` as the fourth 
+            // > parameter to `http_parser_execute()`
+            //
+            // [1]: https://github.com/nodejs/http-parser
+            //
+            // If the message is already complete, the parser is paused (see
+            // `on_message_complete`), and this does nothing.
+            http_parser_execute(&parser, 
+                                &parser_settings,
+                                bytes + size,
+                                0);
 
-        auto body = std::vector<uint8_t> { };
+            if (parser.http_errno &&
+                parser.http_errno != parser::HPE_PAUSED)
+            {
+                auto ec = data.error 
+                    ? data.error
+                    : data.decoding.error 
+                        ? data.decoding.error
+                        : make_error_code(
+                              static_cast<ParseError>(parser.http_errno));
 
-        body.reserve(
-            std::accumulate(data.body_chunks.begin(),
-                    data.body_chunks.end(),
-                    static_cast<size_t>(0),
-                    [](auto const& acc, auto const& item) {
-                        return acc + (item.end - item.start);
+                return result::err(
+                    parse_failed(ec, bytes, size, parsed_len, options));
+            }
+
+            assert(parsed_len);
+
+            auto hdrs = std::vector<Header> { };
+            hdrs.reserve(data.headers.size());
+
+            std::transform(
+                data.headers.begin(), 
+                data.headers.end(),
+                std::back_inserter(hdrs),
+                [](auto h) {
+                    assert(std::get<0>(h).end >= std::get<0>(h).start);
+                    assert(std::get<1>(h).end >= std::get<1>(h).start);
+
+                    auto const& name = std::get<0>(h);
+                    auto const& value = std::get<1>(h);
+                    return std::make_pair(
+                        std::string { name.start, name.end },
+                        std::string { value.start, value.end });
+                });
+
+            auto body = make_body(data, hdrs, in_place);
+            if (!body) {
+                return result::err(parse_failed(result::error(std::move(body)),
+                                                bytes,
+                                                size,
+                                                parsed_len,
+                                                options));
+            }
+
+            return result::ok(std::make_pair(
+                HttpResponseBuilder { }
+                    .with_protocol({ 
+                        Version::Http11,
+                        static_cast<size_t>(parser.status_code),
+                        std::string { 
+                            data.status_text.start, 
+                            data.status_text.end 
+                        }
                     })
-        );
+                    .with_headers(std::move(hdrs))
+                    .with_upgrade(parser.upgrade)
+                    .build(result::value(std::move(body))),
+                parsed_len
+            ));
+    }
 
-        std::for_each(
-            data.body_chunks.begin(),
-            data.body_chunks.end(),
-            [&](auto ch) {
-                assert(ch.start != nullptr);
-                assert(ch.end != nullptr);
-                std::copy(
-                    ch.start,
-                    ch.end,
-                    std::back_inserter(body)
-                );
-            });
-
-        return result::ok(std::make_pair(
-            HttpResponseBuilder { }
-                .with_protocol({ 
-                    Version::Http11,
-                    static_cast<size_t>(parser.status_code),
-                    std::string { 
-                        data.status_text.start, 
-                        data.status_text.end 
-                    }
-                })
-                .with_headers(std::move(hdrs))
-                .build(std::move(body)),
-            parsed_len
-        ));
+}
+
+auto http::detail::parse_response(char const* bytes, 
+                                  size_t size,
+                                  ParseOptions const& options) noexcept
+    -> ParseResult<std::pair<HttpResponse, size_t>>
+{
+    return execute_response(bytes, size, options, false);
+}
+
+auto http::detail::parse_response_in_place(char* bytes, 
+                                           size_t size,
+                                           ParseOptions const& options) noexcept
+    -> ParseResult<std::pair<HttpResponse, size_t>>
+{
+    return execute_response(bytes, size, options, true);
 }
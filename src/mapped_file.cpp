@@ -0,0 +1,279 @@
+#include "http/mapped_file.hpp"
+#include <utility>
+#include <cstdlib>
+#include <string>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+using namespace http;
+
+namespace {
+
+    auto last_error() -> std::error_code {
+#ifndef _WIN32
+        return { errno, std::system_category() };
+#else
+        return std::make_error_code(std::errc::not_supported);
+#endif
+    }
+
+#ifndef _WIN32
+    struct FileDescriptor {
+        explicit FileDescriptor(int fd) : fd { fd } { }
+        ~FileDescriptor() { if (fd >= 0) { ::close(fd); } }
+
+        int fd;
+    };
+
+    // Creates a temporary file in `$TMPDIR` (or `/tmp`). We only ever
+    // refer to the file through its descriptor, or a mapping of it, so
+    // the directory entry is removed straight away; the storage is
+    // released when the last of those is closed. The descriptor is
+    // close-on-exec, so it isn't leaked into child processes...
+    auto open_temporary() noexcept -> int {
+        auto const* dir = std::getenv("TMPDIR");
+        auto path = std::string { (dir && *dir) ? dir : "/tmp" };
+        path += "/http-body-XXXXXX";
+
+        auto fd = ::mkostemp(&path[0], O_CLOEXEC);
+        if (fd >= 0) {
+            ::unlink(path.c_str());
+        }
+
+        return fd;
+    }
+#endif
+}
+
+MappedFile::MappedFile() noexcept
+    :   data_ { nullptr }
+    ,   size_ { 0 }
+{ }
+
+MappedFile::MappedFile(uint8_t* data, size_t size) noexcept
+    :   data_ { data }
+    ,   size_ { size }
+{ }
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    :   data_ { other.data_ }
+    ,   size_ { other.size_ }
+{
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (data_) {
+        ::munmap(data_, size_);
+    }
+#endif
+}
+
+auto MappedFile::operator=(MappedFile&& other) noexcept -> MappedFile& {
+    auto tmp = MappedFile { std::move(other) };
+    std::swap(data_, tmp.data_);
+    std::swap(size_, tmp.size_);
+    return *this;
+}
+
+TemporaryFile::TemporaryFile() noexcept
+    :   fd_ { -1 }
+    ,   size_ { 0 }
+{ }
+
+TemporaryFile::TemporaryFile(int fd) noexcept
+    :   fd_ { fd }
+    ,   size_ { 0 }
+{ }
+
+TemporaryFile::TemporaryFile(TemporaryFile&& other) noexcept
+    :   fd_ { other.fd_ }
+    ,   size_ { other.size_ }
+{
+    other.fd_ = -1;
+    other.size_ = 0;
+}
+
+TemporaryFile::~TemporaryFile() {
+    close();
+}
+
+auto TemporaryFile::operator=(TemporaryFile&& other) noexcept
+    -> TemporaryFile&
+{
+    auto tmp = TemporaryFile { std::move(other) };
+    std::swap(fd_, tmp.fd_);
+    std::swap(size_, tmp.size_);
+    return *this;
+}
+
+auto TemporaryFile::close() noexcept -> void {
+#ifndef _WIN32
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+#endif
+
+    fd_ = -1;
+}
+
+#ifndef _WIN32
+
+auto MappedFile::open(char const* path) noexcept
+    -> result::Result<MappedFile, std::error_code>
+{
+    auto file = FileDescriptor { ::open(path, O_RDONLY | O_CLOEXEC) };
+    if (file.fd < 0) {
+        return result::err(last_error());
+    }
+
+    struct stat st;
+    if (::fstat(file.fd, &st) < 0) {
+        return result::err(last_error());
+    }
+
+    auto size = static_cast<size_t>(st.st_size);
+    if (!size) {
+        return result::ok(MappedFile { });
+    }
+
+    // `MAP_PRIVATE` gives us copy-on-write pages, so callers may modify
+    // the body in-place without touching the file on disk...
+    auto* p = ::mmap(nullptr,
+                     size,
+                     PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE,
+                     file.fd,
+                     0);
+    if (p == MAP_FAILED) {
+        return result::err(last_error());
+    }
+
+    return result::ok(MappedFile { static_cast<uint8_t*>(p), size });
+}
+
+auto MappedFile::create_temporary(size_t size) noexcept
+    -> result::Result<MappedFile, std::error_code>
+{
+    if (!size) {
+        return result::ok(MappedFile { });
+    }
+
+    auto file = FileDescriptor { open_temporary() };
+    if (file.fd < 0) {
+        return result::err(last_error());
+    }
+
+    if (::ftruncate(file.fd, static_cast<off_t>(size)) < 0) {
+        return result::err(last_error());
+    }
+
+    auto* p = ::mmap(nullptr,
+                     size,
+                     PROT_READ | PROT_WRITE,
+                     MAP_SHARED,
+                     file.fd,
+                     0);
+    if (p == MAP_FAILED) {
+        return result::err(last_error());
+    }
+
+    return result::ok(MappedFile { static_cast<uint8_t*>(p), size });
+}
+
+auto TemporaryFile::create() noexcept
+    -> result::Result<TemporaryFile, std::error_code>
+{
+    auto fd = open_temporary();
+    if (fd < 0) {
+        return result::err(last_error());
+    }
+
+    return result::ok(TemporaryFile { fd });
+}
+
+auto TemporaryFile::write(void const* data, size_t size) noexcept
+    -> std::error_code
+{
+    auto const* p = static_cast<char const*>(data);
+    while (size) {
+        auto n = ::write(fd_, p, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n < 0) {
+            return last_error();
+        }
+
+        p += n;
+        size -= static_cast<size_t>(n);
+        size_ += static_cast<size_t>(n);
+    }
+
+    return { };
+}
+
+auto TemporaryFile::map() && noexcept
+    -> result::Result<MappedFile, std::error_code>
+{
+    auto file = std::move(*this);
+    if (!file.size_) {
+        return result::ok(MappedFile { });
+    }
+
+    auto* p = ::mmap(nullptr,
+                     file.size_,
+                     PROT_READ | PROT_WRITE,
+                     MAP_SHARED,
+                     file.fd_,
+                     0);
+    if (p == MAP_FAILED) {
+        return result::err(last_error());
+    }
+
+    return result::ok(MappedFile { static_cast<uint8_t*>(p), file.size_ });
+}
+
+#else
+
+// Windows has no `mmap()`, and nothing here uses `CreateFileMapping`
+// instead. Callers keep bodies in a `BodyContainer` there, and
+// `ParseOptions::body_spill_threshold` is rejected...
+auto MappedFile::open(char const*) noexcept
+    -> result::Result<MappedFile, std::error_code>
+{
+    return result::err(last_error());
+}
+
+auto MappedFile::create_temporary(size_t) noexcept
+    -> result::Result<MappedFile, std::error_code>
+{
+    return result::err(last_error());
+}
+
+auto TemporaryFile::create() noexcept
+    -> result::Result<TemporaryFile, std::error_code>
+{
+    return result::err(last_error());
+}
+
+auto TemporaryFile::write(void const*, size_t) noexcept -> std::error_code {
+    return last_error();
+}
+
+auto TemporaryFile::map() && noexcept
+    -> result::Result<MappedFile, std::error_code>
+{
+    return result::err(last_error());
+}
+
+#endif
@@ -0,0 +1,672 @@
+#include "http/response_cache.hpp"
+#include "http/date.hpp"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include <cassert>
+
+using namespace http;
+
+namespace {
+
+    struct CacheControl {
+        bool no_store = false;
+        bool no_cache = false;
+        bool is_private = false;
+        bool has_max_age = false;
+        long long max_age = 0;
+    };
+
+    auto is_space(char c) -> bool {
+        return c == ' ' || c == '\t';
+    }
+
+    // Calls `f(first, last)` for each non-empty, comma-separated element
+    // of `value`, with surrounding whitespace removed...
+    template<typename F>
+    auto for_each_element(std::string const& value, F f) -> void {
+        auto const* p = value.data();
+        auto const* end = value.data() + value.size();
+
+        while (p != end) {
+            auto const* next = std::find(p, end, ',');
+            auto const* first = p;
+            auto const* last = next;
+
+            while (first != last && is_space(*first)) { ++first; }
+            while (last != first && is_space(*(last-1))) { --last; }
+
+            if (first != last) {
+                f(first, last);
+            }
+
+            p = (next == end) ? end : next + 1;
+        }
+    }
+
+    template<typename F>
+    auto for_each_header_element(HeaderContainer const& headers,
+                                 char const* name,
+                                 F f) -> void
+    {
+        for (auto const& h : headers) {
+            if (detail::iequals(std::get<0>(h), name)) {
+                for_each_element(std::get<1>(h), f);
+            }
+        }
+    }
+
+    auto iequals(char const* first, char const* last, char const* rhs)
+        -> bool
+    {
+        return detail::iequals(first,
+                               last,
+                               rhs,
+                               rhs + std::char_traits<char>::length(rhs));
+    }
+
+    auto parse_seconds(char const* first, char const* last, long long& out)
+        -> bool
+    {
+        if (first != last && *first == '"' && *(last-1) == '"' &&
+            (last - first) >= 2)
+        {
+            ++first;
+            --last;
+        }
+
+        if (first == last) {
+            return false;
+        }
+
+        auto value = 0LL;
+        for (; first != last; ++first) {
+            if (*first < '0' || *first > '9') {
+                return false;
+            }
+
+            // Clamp rather than overflow; anything this large is
+            // effectively "forever"...
+            value = std::min(value * 10 + (*first - '0'),
+                             static_cast<long long>(1) << 40);
+        }
+
+        out = value;
+        return true;
+    }
+
+    auto parse_cache_control(HeaderContainer const& headers) -> CacheControl {
+        auto cc = CacheControl { };
+        auto has_s_maxage = false;
+
+        for_each_header_element(
+            headers,
+            "Cache-Control",
+            [&](char const* first, char const* last) {
+                auto const* eq = std::find(first, last, '=');
+                auto const* value = (eq == last) ? last : eq + 1;
+
+                if (iequals(first, eq, "no-store")) {
+                    cc.no_store = true;
+                }
+                else if (iequals(first, eq, "no-cache")) {
+                    cc.no_cache = true;
+                }
+                else if (iequals(first, eq, "private")) {
+                    cc.is_private = true;
+                }
+                else if (iequals(first, eq, "s-maxage")) {
+                    // `s-maxage` takes precedence over `max-age` in a
+                    // shared cache...
+                    if (parse_seconds(value, last, cc.max_age)) {
+                        cc.has_max_age = true;
+                        has_s_maxage = true;
+                    }
+                }
+                else if (iequals(first, eq, "max-age") && !has_s_maxage) {
+                    auto seconds = 0LL;
+                    if (parse_seconds(value, last, seconds)) {
+                        cc.max_age = seconds;
+                        cc.has_max_age = true;
+                    }
+                }
+            });
+
+        return cc;
+    }
+
+    auto request_bypasses_cache(HttpRequest const& request) -> bool {
+        auto cc = parse_cache_control(request.headers());
+        if (cc.no_cache || cc.no_store) {
+            return true;
+        }
+
+        auto bypass = false;
+        for_each_header_element(
+            request.headers(),
+            "Pragma",
+            [&](char const* first, char const* last) {
+                bypass = bypass || iequals(first, last, "no-cache");
+            });
+
+        return bypass;
+    }
+
+    // Compares two entity-tags using the "weak" comparison function from
+    // RFC 7232, Section 2.3.2...
+    auto weak_etag_equals(char const* first1,
+                          char const* last1,
+                          std::string const& rhs) -> bool
+    {
+        auto strip = [](char const*& first, char const* last) {
+            if ((last - first) >= 2 && first[0] == 'W' && first[1] == '/') {
+                first += 2;
+            }
+        };
+
+        auto const* first2 = rhs.data();
+        auto const* last2 = rhs.data() + rhs.size();
+
+        strip(first1, last1);
+        strip(first2, last2);
+
+        return (last1 - first1) == (last2 - first2) &&
+            std::equal(first1, last1, first2);
+    }
+
+    auto header_value(HeaderContainer const& headers, char const* name)
+        -> std::string
+    {
+        auto it = find_header(headers, name);
+        return it != headers.end() ? std::get<1>(*it) : std::string { };
+    }
+
+    // The `Age` a response arrived with, from caches it passed through on
+    // the way here. A missing or invalid header counts as zero...
+    auto received_age(HttpResponse const& response) -> long long {
+        auto it = find_header(response.headers(), "Age");
+        if (it == response.headers().end()) {
+            return 0;
+        }
+
+        auto const& value = std::get<1>(*it);
+        auto age = 0LL;
+        if (!parse_seconds(value.data(), value.data() + value.size(), age)) {
+            return 0;
+        }
+
+        return age;
+    }
+
+    auto make_key(HttpRequest const& request) -> std::string {
+        auto key = std::string { };
+        key.reserve(request.path().size() + 2);
+        key += static_cast<char>('0' + static_cast<int>(request.method()));
+        key += ' ';
+        key += request.path();
+        return key;
+    }
+
+    auto make_variant_values(HttpRequest const& request,
+                             std::vector<std::string> const& vary)
+        -> std::string
+    {
+        auto values = std::string { };
+        for (auto const& name : vary) {
+            auto it = find_header(request.headers(), name.c_str());
+            if (it != request.headers().end()) {
+                values += '1';
+                values += std::get<1>(*it);
+            }
+            else {
+                values += '0';
+            }
+
+            values += '\0';
+        }
+
+        return values;
+    }
+
+    // Only `chunked` is undone by the parser, so a body sent with any
+    // other transfer-coding is still encoded...
+    auto has_transfer_coding(HttpResponse const& response) -> bool {
+        auto coded = false;
+        for_each_header_element(
+            response.headers(),
+            "Transfer-Encoding",
+            [&](char const* first, char const* last) {
+                coded = coded || !iequals(first, last, "chunked");
+            });
+
+        return coded;
+    }
+
+    // A serialized response whose `Date` and `Age` headers are brought up
+    // to date each time it is served. They are written first, so their
+    // values are at fixed offsets...
+    struct StampedResponse {
+        // Returns the response with a `Date` of `current_date()` and an
+        // `Age` of `age` seconds. The bytes are only copied when one of
+        // those has changed since the last call, so at most once a
+        // second...
+        auto stamp(size_t age) -> std::shared_ptr<std::string const> {
+            char buffer[detail::DECIMAL_MAX];
+            auto const* digits = detail::format_decimal(age, buffer);
+            auto const digits_length = 
+                static_cast<size_t>(std::end(buffer) - digits);
+
+            auto const* date = current_date();
+            if (std::memcmp(bytes->data() + date_offset, 
+                            date, 
+                            DATE_LENGTH) == 0 &&
+                bytes->compare(age_offset, 
+                               age_length, 
+                               digits, 
+                               digits_length) == 0)
+            {
+                return bytes;
+            }
+
+            auto stamped = std::string { };
+            stamped.reserve(bytes->size() - age_length + digits_length);
+            stamped.append(*bytes, 0, age_offset);
+            stamped.append(digits, digits_length);
+            stamped.append(*bytes, age_offset + age_length, std::string::npos);
+            std::memcpy(&stamped[date_offset], date, DATE_LENGTH);
+
+            bytes = std::make_shared<std::string const>(std::move(stamped));
+            age_length = digits_length;
+            return bytes;
+        }
+
+        std::shared_ptr<std::string const> bytes;
+        size_t date_offset;
+        size_t age_offset;
+        size_t age_length;
+    };
+
+    // Serializes `response`, but with `headers`, and with `Date` and
+    // `Age` headers of our own (see `StampedResponse`)...
+    auto serialize(HttpResponse const& response, 
+                   HeaderContainer const& headers) -> StampedResponse
+    {
+        std::ostringstream os;
+        detail::write_status_line(os, response);
+
+        os << "Date: ";
+        auto const date_offset = static_cast<size_t>(os.tellp());
+        os.write(current_date(), DATE_LENGTH);
+
+        os << "\r\nAge: ";
+        auto const age_offset = static_cast<size_t>(os.tellp());
+        os << "0\r\n";
+
+        for (auto const& h : headers) {
+            if (!detail::iequals(std::get<0>(h), "Date") &&
+                !detail::iequals(std::get<0>(h), "Age"))
+            {
+                os << h << "\r\n";
+            }
+        }
+
+        os << "\r\n";
+        os.write(reinterpret_cast<char const*>(response.body().data()),
+                 response.body().size());
+
+        return {
+            std::make_shared<std::string const>(os.str()),
+            date_offset,
+            age_offset,
+            1
+        };
+    }
+
+    auto make_not_modified(HttpResponse const& response) -> HttpResponse {
+        constexpr char const* PRESERVED[] = {
+            "Cache-Control",
+            "Content-Location",
+            "ETag",
+            "Expires",
+            "Last-Modified",
+            "Vary",
+        };
+
+        auto headers = HeaderContainer { };
+        for (auto const& h : response.headers()) {
+            auto preserve = std::any_of(
+                std::begin(PRESERVED),
+                std::end(PRESERVED),
+                [&](auto const* name) {
+                    return detail::iequals(std::get<0>(h), name);
+                });
+
+            if (preserve) {
+                headers.push_back(h);
+            }
+        }
+
+        return HttpResponseBuilder { }
+            .with_protocol({
+                response.version(),
+                static_cast<size_t>(304),
+                "Not Modified"
+            })
+            .with_headers(std::move(headers))
+            .build();
+    }
+}
+
+struct ResponseCache::Shard {
+    struct Variant {
+        std::string values;
+        Clock::time_point stored;
+        Clock::time_point expires;
+        std::string etag;
+        std::string last_modified;
+        StampedResponse response;
+        StampedResponse not_modified;
+        size_t cost;
+    };
+
+    struct Resource {
+        std::string key;
+        std::vector<std::string> vary;
+        std::vector<Variant> variants;
+        size_t cost;
+    };
+
+    using ResourceList = std::list<Resource>;
+
+    explicit Shard(size_t budget) :
+        budget { budget }
+    ,   bytes { 0 }
+    { }
+
+    auto erase(ResourceList::iterator it) -> void {
+        assert(bytes >= it->cost);
+        bytes -= it->cost;
+        index.erase(it->key);
+        lru.erase(it);
+    }
+
+    auto erase_variant(ResourceList::iterator it, size_t n) -> void {
+        auto cost = it->variants[n].cost;
+        it->variants.erase(it->variants.begin() + n);
+        it->cost -= cost;
+        bytes -= cost;
+
+        if (it->variants.empty()) {
+            erase(it);
+        }
+    }
+
+    auto evict(size_t required) -> void {
+        while (!lru.empty() && (bytes + required) > budget) {
+            erase(std::prev(lru.end()));
+        }
+    }
+
+    std::mutex mutex;
+    size_t budget;
+    size_t bytes;
+    ResourceList lru;
+    std::unordered_map<std::string, ResourceList::iterator> index;
+};
+
+ResponseCache::ResponseCache(ResponseCacheOptions options) :
+    options_ { options }
+{
+    options_.shards = std::max(options_.shards, static_cast<size_t>(1));
+    options_.max_variants =
+        std::max(options_.max_variants, static_cast<size_t>(1));
+
+    shards_.reserve(options_.shards);
+    for (size_t i = 0; i < options_.shards; ++i) {
+        shards_.push_back(
+            std::make_unique<Shard>(options_.max_bytes / options_.shards));
+    }
+}
+
+ResponseCache::~ResponseCache() { }
+
+auto ResponseCache::shard_for(std::string const& key) const -> Shard& {
+    return *shards_[std::hash<std::string> { }(key) % shards_.size()];
+}
+
+auto ResponseCache::lookup(HttpRequest const& request,
+                           Clock::time_point now) -> CacheLookup
+{
+    auto miss = CacheLookup { CacheStatus::Miss, nullptr };
+
+    if (request.method() != Method::Get || request_bypasses_cache(request)) {
+        return miss;
+    }
+
+    auto key = make_key(request);
+    auto& shard = shard_for(key);
+
+    std::lock_guard<std::mutex> lock { shard.mutex };
+
+    auto pos = shard.index.find(key);
+    if (pos == shard.index.end()) {
+        return miss;
+    }
+
+    auto it = pos->second;
+    auto values = make_variant_values(request, it->vary);
+    auto variant = std::find_if(
+        it->variants.begin(),
+        it->variants.end(),
+        [&](auto const& v) { return v.values == values; });
+
+    if (variant == it->variants.end()) {
+        return miss;
+    }
+
+    if (now >= variant->expires) {
+        shard.erase_variant(it, variant - it->variants.begin());
+        return miss;
+    }
+
+    shard.lru.splice(shard.lru.begin(), shard.lru, it);
+
+    auto const age = static_cast<size_t>(
+        std::chrono::duration_cast<std::chrono::seconds>(
+            std::max(now - variant->stored, Clock::duration::zero()))
+                .count());
+
+    // `If-None-Match` takes precedence over `If-Modified-Since` when
+    // both are present. See RFC 7232, Section 6...
+    auto const& headers = request.headers();
+    if (find_header(headers, "If-None-Match") != headers.end()) {
+        auto matched = false;
+        if (!variant->etag.empty()) {
+            for_each_header_element(
+                headers,
+                "If-None-Match",
+                [&](char const* first, char const* last) {
+                    matched = matched ||
+                        ((last - first) == 1 && *first == '*') ||
+                        weak_etag_equals(first, last, variant->etag);
+                });
+        }
+
+        if (matched) {
+            return { 
+                CacheStatus::NotModified, 
+                variant->not_modified.stamp(age) 
+            };
+        }
+    }
+    else if (!variant->last_modified.empty()) {
+        auto since = find_header(headers, "If-Modified-Since");
+        if (since != headers.end() &&
+            std::get<1>(*since) == variant->last_modified)
+        {
+            return { 
+                CacheStatus::NotModified, 
+                variant->not_modified.stamp(age) 
+            };
+        }
+    }
+
+    return { CacheStatus::Hit, variant->response.stamp(age) };
+}
+
+auto ResponseCache::store(HttpRequest const& request,
+                          HttpResponse const& response,
+                          Clock::time_point now) -> bool
+{
+    if (request.method() != Method::Get ||
+        response.status_code() != 200 ||
+        find_header(request.headers(), "Authorization") !=
+            request.headers().end())
+    {
+        return false;
+    }
+
+    auto cc = parse_cache_control(response.headers());
+    if (cc.no_store || cc.no_cache || cc.is_private ||
+        !cc.has_max_age || cc.max_age <= 0)
+    {
+        return false;
+    }
+
+    auto vary = std::vector<std::string> { };
+    auto vary_any = false;
+    for_each_header_element(
+        response.headers(),
+        "Vary",
+        [&](char const* first, char const* last) {
+            vary_any = vary_any || ((last - first) == 1 && *first == '*');
+            vary.emplace_back(first, last);
+        });
+
+    if (vary_any || has_transfer_coding(response)) {
+        return false;
+    }
+
+    // Freshness counts from when the response was generated, not from
+    // when it reached us (RFC 7234, section 4.2.3)...
+    auto const age = received_age(response);
+    if (age >= cc.max_age) {
+        return false;
+    }
+
+    auto const stored = now - std::chrono::seconds { age };
+
+    // The body has already been de-chunked, so it is stored with a
+    // `Content-Length` instead...
+    auto headers = response.headers();
+    detail::remove_header(headers, "Transfer-Encoding");
+    detail::set_header(headers, 
+                       "Content-Length", 
+                       std::to_string(response.body().size()));
+
+    auto const not_modified = make_not_modified(response);
+
+    auto key = make_key(request);
+    auto variant = Shard::Variant {
+        make_variant_values(request, vary),
+        stored,
+        stored + std::chrono::seconds { cc.max_age },
+        header_value(response.headers(), "ETag"),
+        header_value(response.headers(), "Last-Modified"),
+        serialize(response, headers),
+        serialize(not_modified, not_modified.headers()),
+        0
+    };
+
+    variant.cost = variant.values.size() +
+        variant.etag.size() +
+        variant.last_modified.size() +
+        variant.response.bytes->size() +
+        variant.not_modified.bytes->size() +
+        sizeof(Shard::Variant);
+
+    auto& shard = shard_for(key);
+    auto resource_cost = key.size() + sizeof(Shard::Resource);
+
+    if (variant.cost + resource_cost > shard.budget) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock { shard.mutex };
+
+    // Take any existing variants out of the shard, so the resource can be
+    // re-inserted at the front of the LRU list with its new cost. If the
+    // resource's `Vary` has changed then its existing variants were
+    // selected using different headers, so we discard them...
+    auto variants = std::vector<Shard::Variant> { };
+    auto pos = shard.index.find(key);
+    if (pos != shard.index.end()) {
+        if (pos->second->vary == vary) {
+            variants = std::move(pos->second->variants);
+        }
+
+        shard.erase(pos->second);
+    }
+
+    variants.erase(
+        std::remove_if(
+            variants.begin(),
+            variants.end(),
+            [&](auto const& v) { 
+                return v.values == variant.values || now >= v.expires; 
+            }),
+        variants.end());
+
+    variants.push_back(std::move(variant));
+
+    auto cost = resource_cost;
+    for (auto const& v : variants) {
+        cost += v.cost;
+    }
+
+    // Drop the oldest variants until we're within our limits. The new
+    // variant always fits on its own, because we checked that above...
+    auto oldest = variants.begin();
+    while ((variants.end() - oldest) > 1 &&
+           ((static_cast<size_t>(variants.end() - oldest) > 
+                options_.max_variants) ||
+            cost > shard.budget))
+    {
+        cost -= oldest->cost;
+        ++oldest;
+    }
+
+    variants.erase(variants.begin(), oldest);
+
+    shard.evict(cost);
+    shard.lru.push_front(
+        Shard::Resource { key, std::move(vary), std::move(variants), cost });
+    shard.index.emplace(std::move(key), shard.lru.begin());
+    shard.bytes += cost;
+
+    return true;
+}
+
+auto ResponseCache::size_bytes() const -> size_t {
+    auto total = static_cast<size_t>(0);
+    for (auto const& shard : shards_) {
+        std::lock_guard<std::mutex> lock { shard->mutex };
+        total += shard->bytes;
+    }
+
+    return total;
+}
+
+auto ResponseCache::clear() -> void {
+    for (auto const& shard : shards_) {
+        std::lock_guard<std::mutex> lock { shard->mutex };
+        shard->lru.clear();
+        shard->index.clear();
+        shard->bytes = 0;
+    }
+}
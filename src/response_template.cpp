@@ -0,0 +1,113 @@
+#include "http/response_template.hpp"
+#include <sstream>
+#include <cstring>
+
+#include <cassert>
+
+using namespace http;
+
+constexpr size_t ResponseTemplate::GATHER_COUNT;
+
+ResponseTemplate::ResponseTemplate(HttpResponseHeaderBuilder&& builder,
+                                   bool with_date)
+    :   ResponseTemplate { std::move(builder).build(), with_date }
+{ }
+
+ResponseTemplate::ResponseTemplate(HttpResponse const& head, bool with_date)
+    :   prefix_ { }
+    ,   suffix_ { "\r\n\r\n" }
+    ,   date_offset_ { 0 }
+    ,   has_date_ { with_date }
+{
+    constexpr char NL[] = "\r\n";
+    constexpr char DATE[] = "Date: ";
+    constexpr char CONTENT_LENGTH[] = "Content-Length: ";
+
+    std::ostringstream os;
+    detail::write_status_line(os, head);
+
+    for (auto const& h : head.headers()) {
+        if (detail::iequals(std::get<0>(h), "Content-Length") ||
+            detail::iequals(std::get<0>(h), "Date"))
+        {
+            continue;
+        }
+
+        os << h;
+        os.write(NL, sizeof(NL) - 1);
+    }
+
+    if (has_date_) {
+        os.write(DATE, sizeof(DATE) - 1);
+        date_offset_ = static_cast<size_t>(os.tellp());
+
+        // Placeholder, overwritten by each response...
+        os << std::string(DATE_LENGTH, ' ');
+        os.write(NL, sizeof(NL) - 1);
+    }
+
+    os.write(CONTENT_LENGTH, sizeof(CONTENT_LENGTH) - 1);
+    prefix_ = os.str();
+}
+
+auto ResponseTemplate::render_head(char* out,
+                                   size_t content_length,
+                                   char const* date) const noexcept -> size_t
+{
+    auto* p = out;
+
+    std::memcpy(p, prefix_.data(), prefix_.size());
+    if (has_date_) {
+        assert(date);
+        std::memcpy(p + date_offset_, date, DATE_LENGTH);
+    }
+
+    p += prefix_.size();
+
+    char digits[detail::DECIMAL_MAX];
+    auto const* first = detail::format_decimal(content_length, digits);
+    auto const len = static_cast<size_t>(std::end(digits) - first);
+
+    std::memcpy(p, first, len);
+    p += len;
+
+    std::memcpy(p, suffix_.data(), suffix_.size());
+    p += suffix_.size();
+
+    return static_cast<size_t>(p - out);
+}
+
+auto ResponseTemplate::gather(Fields& fields,
+                              char const* date,
+                              void const* body,
+                              size_t body_size) const noexcept
+    -> std::array<ConstBuffer, GATHER_COUNT>
+{
+    auto const* first = detail::format_decimal(body_size,
+                                               fields.content_length);
+    auto const digits = static_cast<size_t>(
+        std::end(fields.content_length) - first);
+
+    if (!has_date_) {
+        return {{
+            { prefix_.data(), prefix_.size() },
+            { nullptr, 0 },
+            { nullptr, 0 },
+            { first, digits },
+            { suffix_.data(), suffix_.size() },
+            { body, body_size },
+        }};
+    }
+
+    assert(date);
+    auto const date_end = date_offset_ + DATE_LENGTH;
+
+    return {{
+        { prefix_.data(), date_offset_ },
+        { date, DATE_LENGTH },
+        { prefix_.data() + date_end, prefix_.size() - date_end },
+        { first, digits },
+        { suffix_.data(), suffix_.size() },
+        { body, body_size },
+    }};
+}
@@ -0,0 +1,379 @@
+#include "http/router.hpp"
+#include <algorithm>
+
+#include <cassert>
+
+using namespace http;
+using namespace http::detail;
+
+namespace {
+
+    RouteErrorCategory const ROUTE_ERROR_CATEGORY_INSTANCE { };
+
+    enum class TokenKind {
+        Static,
+        Parameter,
+        Wildcard,
+    };
+
+    struct Token {
+        TokenKind kind;
+        StringView text;
+    };
+
+    // Splits a pattern into runs of static text, `:parameter` segments
+    // and a trailing `*wildcard`...
+    auto tokenize(StringView pattern)
+        -> result::Result<std::vector<Token>, std::error_code>
+    {
+        auto tokens = std::vector<Token> { };
+        auto const* p = pattern.begin();
+        auto const* static_start = p;
+
+        if (pattern.empty() || pattern[0] != '/') {
+            return result::err(
+                make_error_code(RouteError::MISSING_LEADING_SLASH));
+        }
+
+        while (p != pattern.end()) {
+            auto const at_segment_start = (p != pattern.begin() && *(p-1) == '/');
+            if (!at_segment_start || (*p != ':' && *p != '*')) {
+                ++p;
+                continue;
+            }
+
+            if (p != static_start) {
+                tokens.push_back({ 
+                    TokenKind::Static, 
+                    { static_start, static_cast<size_t>(p - static_start) }
+                });
+            }
+
+            auto const kind = (*p == ':') 
+                ? TokenKind::Parameter 
+                : TokenKind::Wildcard;
+            auto const* name = p + 1;
+            auto const* end = std::find(name, pattern.end(), '/');
+
+            if (name == end) {
+                return result::err(
+                    make_error_code(RouteError::UNNAMED_PARAMETER));
+            }
+
+            if (kind == TokenKind::Wildcard && end != pattern.end()) {
+                return result::err(
+                    make_error_code(RouteError::MISPLACED_WILDCARD));
+            }
+
+            tokens.push_back({ 
+                kind, 
+                { name, static_cast<size_t>(end - name) } 
+            });
+
+            p = static_start = end;
+        }
+
+        if (p != static_start) {
+            tokens.push_back({ 
+                TokenKind::Static, 
+                { static_start, static_cast<size_t>(p - static_start) }
+            });
+        }
+
+        return result::ok(std::move(tokens));
+    }
+}
+
+auto RouteErrorCategory::name() const noexcept -> char const* {
+    return "router";
+}
+
+auto RouteErrorCategory::message(int ec) const -> std::string {
+    switch(static_cast<RouteError>(ec)) {
+        case RouteError::MISSING_LEADING_SLASH:
+            return "route patterns must begin with '/'";
+        case RouteError::UNNAMED_PARAMETER:
+            return "route parameters must be named";
+        case RouteError::MISPLACED_WILDCARD:
+            return "a wildcard must be the last segment of a route";
+        case RouteError::TOO_MANY_PARAMETERS:
+            return "too many route parameters";
+        case RouteError::DUPLICATE_ROUTE:
+            return "duplicate route";
+        default:
+            return "an unknown error occurred";
+    }
+}
+
+auto http::route_category() -> RouteErrorCategory const& {
+    return ROUTE_ERROR_CATEGORY_INSTANCE;
+}
+
+auto http::make_error_code(RouteError e) -> std::error_code {
+    return { static_cast<int>(e), ROUTE_ERROR_CATEGORY_INSTANCE };
+}
+
+RouteTable::RouteTable()
+    :   nodes_ { }
+    ,   roots_ { }
+    ,   names_ { }
+{
+    for (auto& root : roots_) {
+        root = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+    }
+}
+
+auto RouteTable::insert_static(uint32_t node, StringView text) -> uint32_t {
+    while (!text.empty()) {
+        auto& edges = nodes_[node].edges;
+        auto pos = std::lower_bound(
+            edges.begin(),
+            edges.end(),
+            text[0],
+            [](auto const& e, char c) { return e.label[0] < c; });
+
+        if (pos == edges.end() || pos->label[0] != text[0]) {
+            auto child = static_cast<uint32_t>(nodes_.size());
+            edges.insert(pos, Edge { text.to_string(), child });
+            nodes_.emplace_back();
+            return child;
+        }
+
+        auto const common = static_cast<size_t>(
+            std::mismatch(pos->label.begin(),
+                          pos->label.end(),
+                          text.begin(),
+                          text.end()).first - pos->label.begin());
+
+        if (common < pos->label.size()) {
+            // Split the edge, so that the shared prefix leads to a new
+            // intermediate node...
+            auto mid = static_cast<uint32_t>(nodes_.size());
+            auto old_child = pos->child;
+            auto rest = pos->label.substr(common);
+
+            pos->label.resize(common);
+            pos->child = mid;
+
+            // NOTE: `pos` and `edges` are invalidated here...
+            nodes_.emplace_back();
+            nodes_[mid].edges.push_back(Edge { std::move(rest), old_child });
+            node = mid;
+        }
+        else {
+            node = pos->child;
+        }
+
+        text = text.substr(common, text.size() - common);
+    }
+
+    return node;
+}
+
+auto RouteTable::find_static(uint32_t node, StringView text) const noexcept
+    -> int32_t
+{
+    while (!text.empty()) {
+        auto const& edges = nodes_[node].edges;
+        auto pos = std::lower_bound(
+            edges.begin(),
+            edges.end(),
+            text[0],
+            [](auto const& e, char c) { return e.label[0] < c; });
+
+        if (pos == edges.end() ||
+            pos->label.size() > text.size() ||
+            !std::equal(pos->label.begin(), pos->label.end(), text.begin()))
+        {
+            return -1;
+        }
+
+        node = pos->child;
+        text = text.substr(pos->label.size(), 
+                           text.size() - pos->label.size());
+    }
+
+    return static_cast<int32_t>(node);
+}
+
+auto RouteTable::add(Method method, StringView pattern, size_t route)
+    -> std::error_code
+{
+    auto tokenized = tokenize(pattern);
+    if (!tokenized) {
+        return result::error(std::move(tokenized));
+    }
+
+    auto const tokens = result::value(std::move(tokenized));
+    auto const root = roots_[static_cast<size_t>(method)];
+
+    // Validate the pattern before touching the tree, so that a rejected
+    // pattern leaves no nodes behind...
+    auto const parameter_count = std::count_if(
+        tokens.begin(),
+        tokens.end(),
+        [](auto const& t) { return t.kind != TokenKind::Static; });
+
+    if (static_cast<size_t>(parameter_count) > MAX_ROUTE_PARAMETERS) {
+        return make_error_code(RouteError::TOO_MANY_PARAMETERS);
+    }
+
+    auto const is_wildcard = !tokens.empty() && 
+                             tokens.back().kind == TokenKind::Wildcard;
+
+    auto existing = static_cast<int32_t>(root);
+    for (auto const& t : tokens) {
+        if (existing < 0) {
+            break;
+        }
+
+        switch (t.kind) {
+            case TokenKind::Static:
+                existing = find_static(static_cast<uint32_t>(existing), t.text);
+                break;
+            case TokenKind::Parameter:
+                existing = nodes_[static_cast<size_t>(existing)].param_child;
+                break;
+            case TokenKind::Wildcard:
+                break;
+        }
+    }
+
+    if (existing >= 0) {
+        auto const& n = nodes_[static_cast<size_t>(existing)];
+        if ((is_wildcard ? n.wildcard_route : n.route) >= 0) {
+            return make_error_code(RouteError::DUPLICATE_ROUTE);
+        }
+    }
+
+    auto names = std::vector<std::string> { };
+    auto node = root;
+
+    for (auto const& t : tokens) {
+        switch (t.kind) {
+            case TokenKind::Static:
+                node = insert_static(node, t.text);
+                break;
+            case TokenKind::Parameter:
+                if (nodes_[node].param_child < 0) {
+                    nodes_[node].param_child = 
+                        static_cast<int32_t>(nodes_.size());
+                    nodes_.emplace_back();
+                }
+
+                node = static_cast<uint32_t>(nodes_[node].param_child);
+                names.push_back(t.text.to_string());
+                break;
+            case TokenKind::Wildcard:
+                names.push_back(t.text.to_string());
+                break;
+        }
+    }
+
+    auto& target = is_wildcard
+        ? nodes_[node].wildcard_route
+        : nodes_[node].route;
+
+    assert(target < 0);
+
+    if (names_.size() <= route) {
+        names_.resize(route + 1);
+    }
+
+    target = static_cast<int32_t>(route);
+    names_[route] = std::move(names);
+    return { };
+}
+
+auto RouteTable::match(uint32_t node,
+                       char const* p,
+                       char const* end,
+                       RouteParameters& parameters,
+                       size_t count) const noexcept -> int32_t
+{
+    auto const& n = nodes_[node];
+
+    if (p == end && n.route >= 0) {
+        parameters.size_ = count;
+        return n.route;
+    }
+
+    if (p != end) {
+        auto pos = std::lower_bound(
+            n.edges.begin(),
+            n.edges.end(),
+            *p,
+            [](auto const& e, char c) { return e.label[0] < c; });
+
+        if (pos != n.edges.end() &&
+            pos->label[0] == *p &&
+            static_cast<size_t>(end - p) >= pos->label.size() &&
+            std::equal(pos->label.begin(), pos->label.end(), p))
+        {
+            auto r = match(pos->child, 
+                           p + pos->label.size(), 
+                           end, 
+                           parameters, 
+                           count);
+            if (r >= 0) {
+                return r;
+            }
+        }
+
+        if (n.param_child >= 0 && 
+            *p != '/' && 
+            count < MAX_ROUTE_PARAMETERS) 
+        {
+            auto const* segment_end = std::find(p, end, '/');
+            parameters.parameters_[count].value = 
+                { p, static_cast<size_t>(segment_end - p) };
+
+            auto r = match(static_cast<uint32_t>(n.param_child),
+                           segment_end,
+                           end,
+                           parameters,
+                           count + 1);
+            if (r >= 0) {
+                return r;
+            }
+        }
+    }
+
+    if (n.wildcard_route >= 0 && count < MAX_ROUTE_PARAMETERS) {
+        parameters.parameters_[count].value = 
+            { p, static_cast<size_t>(end - p) };
+        parameters.size_ = count + 1;
+        return n.wildcard_route;
+    }
+
+    return -1;
+}
+
+auto RouteTable::match(Method method,
+                       StringView path,
+                       RouteParameters& parameters) const noexcept
+    -> std::ptrdiff_t
+{
+    parameters.size_ = 0;
+
+    auto const m = static_cast<size_t>(method);
+    if (m >= roots_.size()) {
+        return -1;
+    }
+
+    auto r = match(roots_[m], path.begin(), path.end(), parameters, 0);
+    if (r < 0) {
+        return -1;
+    }
+
+    // Captures are positional, so pair each one with its name from the
+    // route that matched...
+    auto const& names = names_[static_cast<size_t>(r)];
+    assert(names.size() == parameters.size_);
+    for (size_t i = 0; i < names.size(); ++i) {
+        parameters.parameters_[i].name = names[i];
+    }
+
+    return r;
+}
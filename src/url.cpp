@@ -0,0 +1,162 @@
+#include "http/url.hpp"
+#include "http/http.hpp"
+#include <algorithm>
+
+using namespace http;
+
+namespace {
+
+    auto hex_value(char c) noexcept -> int {
+        if (c >= '0' && c <= '9') { return c - '0'; }
+        if (c >= 'a' && c <= 'f') { return c - 'a' + 10; }
+        if (c >= 'A' && c <= 'F') { return c - 'A' + 10; }
+        return -1;
+    }
+
+    auto field(StringView target,
+               parser::http_parser_url const& url,
+               parser::http_parser_url_fields f) noexcept -> StringView
+    {
+        if (!(url.field_set & (1 << f))) {
+            return { };
+        }
+
+        return { target.data() + url.field_data[f].off,
+                 url.field_data[f].len };
+    }
+}
+
+QueryIterator::QueryIterator() noexcept
+    :   next_ { nullptr }
+    ,   last_ { nullptr }
+    ,   current_ { }
+{ }
+
+QueryIterator::QueryIterator(char const* first, char const* last) noexcept
+    :   next_ { first }
+    ,   last_ { last }
+    ,   current_ { }
+{
+    ++*this;
+}
+
+auto QueryIterator::operator++() noexcept -> QueryIterator& {
+    // Skip empty parameters, e.g. "a=1&&b=2"...
+    while (next_ != last_ && *next_ == '&') {
+        ++next_;
+    }
+
+    if (next_ == last_) {
+        // Use a distinct state for "end", so that the iterator which has
+        // just produced the final parameter doesn't compare equal to
+        // `end()`...
+        next_ = last_ = nullptr;
+        current_ = { };
+        return *this;
+    }
+
+    auto const* end = std::find(next_, last_, '&');
+    auto const* eq = std::find(next_, end, '=');
+
+    current_.name = { next_, static_cast<size_t>(eq - next_) };
+    current_.value = (eq == end) 
+        ? StringView { end, 0 }
+        : StringView { eq + 1, static_cast<size_t>(end - eq - 1) };
+
+    next_ = end;
+    return *this;
+}
+
+auto QueryIterator::operator++(int) noexcept -> QueryIterator {
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+}
+
+auto RequestTarget::find_query_parameter(StringView name, 
+                                         StringView& value) const noexcept 
+    -> bool
+{
+    for (auto const& p : query_parameters()) {
+        if (p.name == name) {
+            value = p.value;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+auto http::parse_target(StringView target, bool is_connect) noexcept
+    -> result::Result<RequestTarget, std::error_code>
+{
+    // The asterisk-form of `OPTIONS *` isn't a URL, so http-parser won't
+    // accept it...
+    if (target.size() == 1 && target[0] == '*') {
+        return result::ok(RequestTarget { { }, { }, 0, target, { }, { } });
+    }
+
+    // http-parser records offsets as 16-bit integers...
+    if (target.empty() || target.size() > 0xffff) {
+        return result::err(make_error_code(ParseError::INVALID_URL));
+    }
+
+    parser::http_parser_url url;
+    parser::http_parser_url_init(&url);
+
+    if (parser::http_parser_parse_url(target.data(), 
+                                      target.size(), 
+                                      is_connect ? 1 : 0, 
+                                      &url))
+    {
+        return result::err(make_error_code(ParseError::INVALID_URL));
+    }
+
+    return result::ok(RequestTarget {
+        field(target, url, parser::UF_SCHEMA),
+        field(target, url, parser::UF_HOST),
+        url.port,
+        field(target, url, parser::UF_PATH),
+        field(target, url, parser::UF_QUERY),
+        field(target, url, parser::UF_FRAGMENT)
+    });
+}
+
+auto http::percent_decode(StringView in, 
+                          char* out, 
+                          size_t out_size,
+                          bool plus_as_space) noexcept
+    -> result::Result<size_t, std::error_code>
+{
+    auto const* p = in.begin();
+    auto* o = out;
+    auto* const o_end = out + out_size;
+
+    while (p != in.end()) {
+        if (o == o_end) {
+            return result::err(
+                std::make_error_code(std::errc::value_too_large));
+        }
+
+        if (*p == '%') {
+            if ((in.end() - p) < 3) {
+                return result::err(make_error_code(ParseError::INVALID_URL));
+            }
+
+            auto hi = hex_value(p[1]);
+            auto lo = hex_value(p[2]);
+            if (hi < 0 || lo < 0) {
+                return result::err(make_error_code(ParseError::INVALID_URL));
+            }
+
+            *o++ = static_cast<char>((hi << 4) | lo);
+            p += 3;
+        }
+        else {
+            *o++ = (plus_as_space && *p == '+') ? ' ' : *p;
+            ++p;
+        }
+    }
+
+    return result::ok(static_cast<size_t>(o - out));
+}
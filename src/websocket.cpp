@@ -0,0 +1,568 @@
+#include "http/websocket.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HTTP_WEBSOCKET_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HTTP_WEBSOCKET_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace http;
+
+namespace {
+
+    WebSocketErrorCategory const WEBSOCKET_ERROR_CATEGORY_INSTANCE { };
+
+    // Appended to the client's key before hashing, by RFC 6455...
+    constexpr char WEBSOCKET_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+    constexpr char HANDSHAKE_PREFIX[] = 
+        "HTTP/1.1 101 Switching Protocols\r\n"
+        "Upgrade: websocket\r\n"
+        "Connection: Upgrade\r\n"
+        "Sec-WebSocket-Accept: ";
+
+    constexpr char HANDSHAKE_SUFFIX[] = "\r\n\r\n";
+
+    constexpr char BASE64_ALPHABET[] = 
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    // Just enough SHA-1 for the handshake...
+    struct Sha1 {
+        static constexpr size_t DIGEST_SIZE = 20;
+
+        Sha1() noexcept :
+            state_ {{ 
+                0x67452301u, 
+                0xefcdab89u, 
+                0x98badcfeu, 
+                0x10325476u, 
+                0xc3d2e1f0u 
+            }}
+        ,   block_ { }
+        ,   used_ { 0 }
+        ,   length_ { 0 }
+        { }
+
+        auto update(void const* data, size_t size) noexcept -> void {
+            auto const* p = static_cast<uint8_t const*>(data);
+            length_ += size;
+
+            while (size) {
+                auto n = std::min(size, block_.size() - used_);
+                std::memcpy(block_.data() + used_, p, n);
+                used_ += n;
+                p += n;
+                size -= n;
+
+                if (used_ == block_.size()) {
+                    compress();
+                    used_ = 0;
+                }
+            }
+        }
+
+        auto finish(uint8_t (&digest)[DIGEST_SIZE]) noexcept -> void {
+            auto const bits = static_cast<uint64_t>(length_) * 8;
+
+            block_[used_++] = 0x80;
+            if (used_ > 56) {
+                std::fill(block_.begin() + used_, block_.end(), 0);
+                compress();
+                used_ = 0;
+            }
+
+            std::fill(block_.begin() + used_, block_.begin() + 56, 0);
+            for (size_t i = 0; i < 8; ++i) {
+                block_[56 + i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+            }
+
+            compress();
+
+            for (size_t i = 0; i < DIGEST_SIZE; ++i) {
+                digest[i] = static_cast<uint8_t>(
+                    state_[i / 4] >> (24 - 8 * (i % 4)));
+            }
+        }
+
+    private:
+        static auto rotl(uint32_t x, int n) noexcept -> uint32_t {
+            return (x << n) | (x >> (32 - n));
+        }
+
+        auto compress() noexcept -> void {
+            uint32_t w[80];
+            for (size_t i = 0; i < 16; ++i) {
+                w[i] = (static_cast<uint32_t>(block_[i * 4]) << 24) |
+                       (static_cast<uint32_t>(block_[i * 4 + 1]) << 16) |
+                       (static_cast<uint32_t>(block_[i * 4 + 2]) << 8) |
+                       (static_cast<uint32_t>(block_[i * 4 + 3]));
+            }
+
+            for (size_t i = 16; i < 80; ++i) {
+                w[i] = rotl(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+            }
+
+            auto a = state_[0];
+            auto b = state_[1];
+            auto c = state_[2];
+            auto d = state_[3];
+            auto e = state_[4];
+
+            for (size_t i = 0; i < 80; ++i) {
+                uint32_t f, k;
+                if (i < 20) {
+                    f = (b & c) | (~b & d);
+                    k = 0x5a827999u;
+                }
+                else if (i < 40) {
+                    f = b ^ c ^ d;
+                    k = 0x6ed9eba1u;
+                }
+                else if (i < 60) {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8f1bbcdcu;
+                }
+                else {
+                    f = b ^ c ^ d;
+                    k = 0xca62c1d6u;
+                }
+
+                auto t = rotl(a, 5) + f + e + k + w[i];
+                e = d;
+                d = c;
+                c = rotl(b, 30);
+                b = a;
+                a = t;
+            }
+
+            state_[0] += a;
+            state_[1] += b;
+            state_[2] += c;
+            state_[3] += d;
+            state_[4] += e;
+        }
+
+        std::array<uint32_t, 5> state_;
+        std::array<uint8_t, 64> block_;
+        size_t used_;
+        size_t length_;
+    };
+
+    constexpr size_t Sha1::DIGEST_SIZE;
+
+    auto is_base64(char c) noexcept -> bool {
+        return (c >= 'A' && c <= 'Z') || 
+               (c >= 'a' && c <= 'z') ||
+               (c >= '0' && c <= '9') ||
+               c == '+' || 
+               c == '/';
+    }
+
+    // A valid key is 16 bytes, base64 encoded...
+    auto is_valid_key(StringView key) noexcept -> bool {
+        if (key.size() != 24 || key[22] != '=' || key[23] != '=') {
+            return false;
+        }
+
+        return std::all_of(key.begin(), key.begin() + 22, is_base64);
+    }
+
+    auto is_space(char c) noexcept -> bool {
+        return c == ' ' || c == '\t';
+    }
+
+    // `true` if any header called `name` has `token` in its
+    // comma-separated value...
+    auto has_token(HeaderContainer const& headers,
+                   char const* name,
+                   char const* token) noexcept -> bool
+    {
+        auto const* token_end = token + std::char_traits<char>::length(token);
+
+        for (auto const& h : headers) {
+            if (!detail::iequals(std::get<0>(h), name)) {
+                continue;
+            }
+
+            auto const* p = std::get<1>(h).data();
+            auto const* end = p + std::get<1>(h).size();
+            while (p != end) {
+                auto const* next = std::find(p, end, ',');
+                auto const* first = p;
+                auto const* last = next;
+
+                while (first != last && is_space(*first)) { ++first; }
+                while (last != first && is_space(*(last-1))) { --last; }
+
+                if (detail::iequals(first, last, token, token_end)) {
+                    return true;
+                }
+
+                p = (next == end) ? end : next + 1;
+            }
+        }
+
+        return false;
+    }
+
+    auto trimmed_value(std::string const& value) noexcept -> StringView {
+        auto const* first = value.data();
+        auto const* last = first + value.size();
+
+        while (first != last && is_space(*first)) { ++first; }
+        while (last != first && is_space(*(last-1))) { --last; }
+
+        return { first, static_cast<size_t>(last - first) };
+    }
+
+    auto is_valid_opcode(uint8_t opcode) noexcept -> bool {
+        return opcode <= 0x2 || (opcode >= 0x8 && opcode <= 0xa);
+    }
+}
+
+auto WebSocketErrorCategory::name() const noexcept -> char const* {
+    return "websocket";
+}
+
+auto WebSocketErrorCategory::message(int ec) const -> std::string {
+    switch(static_cast<WebSocketError>(ec)) {
+        case WebSocketError::NOT_A_HANDSHAKE:
+            return "request is not a websocket handshake";
+        case WebSocketError::UNSUPPORTED_VERSION:
+            return "unsupported websocket version";
+        case WebSocketError::INVALID_KEY:
+            return "invalid Sec-WebSocket-Key";
+        case WebSocketError::RESERVED_BITS_SET:
+            return "frame has reserved bits set";
+        case WebSocketError::INVALID_OPCODE:
+            return "frame has an invalid opcode";
+        case WebSocketError::FRAGMENTED_CONTROL_FRAME:
+            return "control frame is fragmented";
+        case WebSocketError::CONTROL_FRAME_TOO_LARGE:
+            return "control frame payload is longer than 125 bytes";
+        case WebSocketError::NON_MINIMAL_LENGTH:
+            return "frame length is not minimally encoded";
+        case WebSocketError::FRAME_TOO_LARGE:
+            return "frame payload exceeds the configured size limit";
+        case WebSocketError::UNMASKED_FRAME:
+            return "frame from client is not masked";
+        default: 
+            return "an unknown error occurred";
+    }
+}
+
+auto http::websocket_category() -> WebSocketErrorCategory const& {
+    return WEBSOCKET_ERROR_CATEGORY_INSTANCE;
+}
+
+auto http::make_error_code(WebSocketError e) -> std::error_code {
+    return { static_cast<int>(e), WEBSOCKET_ERROR_CATEGORY_INSTANCE };
+}
+
+auto http::websocket_accept(StringView key, 
+                            char (&out)[WEBSOCKET_ACCEPT_LENGTH]) noexcept 
+    -> void
+{
+    uint8_t digest[Sha1::DIGEST_SIZE];
+
+    auto sha = Sha1 { };
+    sha.update(key.data(), key.size());
+    sha.update(WEBSOCKET_GUID, sizeof(WEBSOCKET_GUID) - 1);
+    sha.finish(digest);
+
+    // 20 bytes encode to 27 characters, plus one of padding...
+    auto* p = out;
+    for (size_t i = 0; i < 18; i += 3) {
+        auto v = (static_cast<uint32_t>(digest[i]) << 16) |
+                 (static_cast<uint32_t>(digest[i+1]) << 8) |
+                 (static_cast<uint32_t>(digest[i+2]));
+        *p++ = BASE64_ALPHABET[(v >> 18) & 0x3f];
+        *p++ = BASE64_ALPHABET[(v >> 12) & 0x3f];
+        *p++ = BASE64_ALPHABET[(v >> 6) & 0x3f];
+        *p++ = BASE64_ALPHABET[v & 0x3f];
+    }
+
+    auto v = (static_cast<uint32_t>(digest[18]) << 16) |
+             (static_cast<uint32_t>(digest[19]) << 8);
+    *p++ = BASE64_ALPHABET[(v >> 18) & 0x3f];
+    *p++ = BASE64_ALPHABET[(v >> 12) & 0x3f];
+    *p++ = BASE64_ALPHABET[(v >> 6) & 0x3f];
+    *p++ = '=';
+}
+
+auto http::is_websocket_handshake(HttpRequest const& request) noexcept 
+    -> bool
+{
+    auto const& headers = request.headers();
+    auto key = find_header(headers, "Sec-WebSocket-Key");
+    auto version = find_header(headers, "Sec-WebSocket-Version");
+
+    return request.method() == Method::Get &&
+           request.version() == Version::Http11 &&
+           has_token(headers, "Upgrade", "websocket") &&
+           has_token(headers, "Connection", "upgrade") &&
+           key != headers.end() &&
+           is_valid_key(trimmed_value(std::get<1>(*key))) &&
+           version != headers.end() &&
+           trimmed_value(std::get<1>(*version)) == "13";
+}
+
+auto http::make_websocket_handshake(HttpRequest const& request)
+    -> result::Result<HttpResponse, std::error_code>
+{
+    auto const& headers = request.headers();
+    auto key = find_header(headers, "Sec-WebSocket-Key");
+
+    if (request.method() != Method::Get ||
+        !has_token(headers, "Upgrade", "websocket") ||
+        !has_token(headers, "Connection", "upgrade") ||
+        key == headers.end())
+    {
+        return result::err(make_error_code(WebSocketError::NOT_A_HANDSHAKE));
+    }
+
+    auto version = find_header(headers, "Sec-WebSocket-Version");
+    if (version == headers.end() || 
+        trimmed_value(std::get<1>(*version)) != "13") 
+    {
+        return result::err(
+            make_error_code(WebSocketError::UNSUPPORTED_VERSION));
+    }
+
+    auto const key_value = trimmed_value(std::get<1>(*key));
+    if (!is_valid_key(key_value)) {
+        return result::err(make_error_code(WebSocketError::INVALID_KEY));
+    }
+
+    char accept[WEBSOCKET_ACCEPT_LENGTH];
+    websocket_accept(key_value, accept);
+
+    return result::ok(
+        HttpResponseBuilder { }
+            .with_protocol({ 
+                Version::Http11,
+                static_cast<size_t>(101),
+                "Switching Protocols"
+            })
+            .with_headers({
+                std::make_pair("Upgrade", "websocket"),
+                std::make_pair("Connection", "Upgrade"),
+                std::make_pair("Sec-WebSocket-Accept", 
+                               std::string { accept, sizeof(accept) })
+            })
+            .with_upgrade()
+            .build());
+}
+
+auto http::render_websocket_handshake(StringView key, char* out) noexcept 
+    -> size_t
+{
+    auto* p = out;
+
+    std::memcpy(p, HANDSHAKE_PREFIX, sizeof(HANDSHAKE_PREFIX) - 1);
+    p += sizeof(HANDSHAKE_PREFIX) - 1;
+
+    char accept[WEBSOCKET_ACCEPT_LENGTH];
+    websocket_accept(key, accept);
+    std::memcpy(p, accept, sizeof(accept));
+    p += sizeof(accept);
+
+    std::memcpy(p, HANDSHAKE_SUFFIX, sizeof(HANDSHAKE_SUFFIX) - 1);
+    p += sizeof(HANDSHAKE_SUFFIX) - 1;
+
+    return static_cast<size_t>(p - out);
+}
+
+auto http::parse_frame(uint8_t* data,
+                       size_t size,
+                       WebSocketFrame& frame,
+                       FrameParseOptions const& options)
+    -> result::Result<size_t, std::error_code>
+{
+    auto fail = [](WebSocketError e) {
+        return result::err(make_error_code(e));
+    };
+
+    if (size < 2) {
+        return result::ok(static_cast<size_t>(0));
+    }
+
+    auto const b0 = data[0];
+    auto const b1 = data[1];
+    auto const opcode = static_cast<uint8_t>(b0 & 0x0f);
+    auto const fin = (b0 & 0x80) != 0;
+    auto const masked = (b1 & 0x80) != 0;
+
+    if (b0 & 0x70) {
+        return fail(WebSocketError::RESERVED_BITS_SET);
+    }
+
+    if (!is_valid_opcode(opcode)) {
+        return fail(WebSocketError::INVALID_OPCODE);
+    }
+
+    auto const is_control = (opcode & 0x8) != 0;
+    if (is_control && !fin) {
+        return fail(WebSocketError::FRAGMENTED_CONTROL_FRAME);
+    }
+
+    if (options.require_mask && !masked) {
+        return fail(WebSocketError::UNMASKED_FRAME);
+    }
+
+    auto header_size = static_cast<size_t>(2);
+    auto length = static_cast<uint64_t>(b1 & 0x7f);
+
+    if (length == 126) {
+        header_size += 2;
+        if (size < header_size) {
+            return result::ok(static_cast<size_t>(0));
+        }
+
+        length = (static_cast<uint64_t>(data[2]) << 8) | data[3];
+        if (length < 126) {
+            return fail(WebSocketError::NON_MINIMAL_LENGTH);
+        }
+    }
+    else if (length == 127) {
+        header_size += 8;
+        if (size < header_size) {
+            return result::ok(static_cast<size_t>(0));
+        }
+
+        length = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            length = (length << 8) | data[2 + i];
+        }
+
+        if (length >> 63) {
+            return fail(WebSocketError::FRAME_TOO_LARGE);
+        }
+
+        if (length <= 0xffff) {
+            return fail(WebSocketError::NON_MINIMAL_LENGTH);
+        }
+    }
+
+    if (is_control && length > 125) {
+        return fail(WebSocketError::CONTROL_FRAME_TOO_LARGE);
+    }
+
+    if (length > options.max_payload_size) {
+        return fail(WebSocketError::FRAME_TOO_LARGE);
+    }
+
+    auto mask = std::array<uint8_t, 4> { };
+    if (masked) {
+        if (size < header_size + 4) {
+            return result::ok(static_cast<size_t>(0));
+        }
+
+        std::memcpy(mask.data(), data + header_size, 4);
+        header_size += 4;
+    }
+
+    auto const payload_size = static_cast<size_t>(length);
+    if (size - header_size < payload_size) {
+        return result::ok(static_cast<size_t>(0));
+    }
+
+    auto* payload = data + header_size;
+    if (masked && options.unmask) {
+        apply_mask(payload, payload_size, mask);
+    }
+
+    frame.fin = fin;
+    frame.opcode = static_cast<Opcode>(opcode);
+    frame.masked = masked;
+    frame.mask = mask;
+    frame.payload = payload;
+    frame.payload_size = payload_size;
+
+    return result::ok(header_size + payload_size);
+}
+
+auto http::apply_mask(uint8_t* data,
+                      size_t size,
+                      std::array<uint8_t, 4> const& mask,
+                      size_t offset) noexcept -> void
+{
+    // The mask repeats every 4 bytes, so a 16 byte pattern lines up with
+    // every 16 and 8 byte step below...
+    uint8_t pattern[16];
+    for (size_t i = 0; i < sizeof(pattern); ++i) {
+        pattern[i] = mask[(offset + i) & 3];
+    }
+
+    auto i = static_cast<size_t>(0);
+
+#if defined(HTTP_WEBSOCKET_SSE2)
+    auto const m = _mm_loadu_si128(reinterpret_cast<__m128i const*>(pattern));
+    for (; i + 16 <= size; i += 16) {
+        auto* p = reinterpret_cast<__m128i*>(data + i);
+        _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), m));
+    }
+#elif defined(HTTP_WEBSOCKET_NEON)
+    auto const m = vld1q_u8(pattern);
+    for (; i + 16 <= size; i += 16) {
+        vst1q_u8(data + i, veorq_u8(vld1q_u8(data + i), m));
+    }
+#endif
+
+    uint64_t m64;
+    std::memcpy(&m64, pattern, sizeof(m64));
+    for (; i + 8 <= size; i += 8) {
+        uint64_t v;
+        std::memcpy(&v, data + i, sizeof(v));
+        v ^= m64;
+        std::memcpy(data + i, &v, sizeof(v));
+    }
+
+    for (; i < size; ++i) {
+        data[i] ^= pattern[i & 3];
+    }
+}
+
+auto http::write_frame_header(uint8_t* out,
+                              Opcode opcode,
+                              size_t payload_size,
+                              bool fin,
+                              std::array<uint8_t, 4> const* mask) noexcept 
+    -> size_t
+{
+    auto const mask_bit = static_cast<uint8_t>(mask ? 0x80 : 0);
+    auto n = static_cast<size_t>(2);
+
+    out[0] = static_cast<uint8_t>((fin ? 0x80 : 0) | 
+                                  static_cast<uint8_t>(opcode));
+
+    if (payload_size < 126) {
+        out[1] = static_cast<uint8_t>(mask_bit | payload_size);
+    }
+    else if (payload_size <= 0xffff) {
+        out[1] = static_cast<uint8_t>(mask_bit | 126);
+        out[2] = static_cast<uint8_t>(payload_size >> 8);
+        out[3] = static_cast<uint8_t>(payload_size);
+        n = 4;
+    }
+    else {
+        auto const length = static_cast<uint64_t>(payload_size);
+        out[1] = static_cast<uint8_t>(mask_bit | 127);
+        for (size_t i = 0; i < 8; ++i) {
+            out[2 + i] = static_cast<uint8_t>(length >> (56 - 8 * i));
+        }
+        n = 10;
+    }
+
+    if (mask) {
+        std::memcpy(out + n, mask->data(), 4);
+        n += 4;
+    }
+
+    return n;
+}
@@ -0,0 +1,59 @@
+#include "http/date.hpp"
+#include "http/http.hpp"
+#include "catch.hpp"
+#include <string>
+#include <cstring>
+
+SCENARIO("Date formatting", "[date]") {
+
+    GIVEN("A point in time") {
+
+        char buffer[http::DATE_LENGTH];
+
+        THEN("It should be formatted as an IMF-fixdate") {
+            http::format_date(784111777, buffer);
+            REQUIRE(std::string { buffer, http::DATE_LENGTH } 
+                == "Sun, 06 Nov 1994 08:49:37 GMT");
+
+            http::format_date(0, buffer);
+            REQUIRE(std::string { buffer, http::DATE_LENGTH } 
+                == "Thu, 01 Jan 1970 00:00:00 GMT");
+
+            http::format_date(951782400, buffer);
+            REQUIRE(std::string { buffer, http::DATE_LENGTH } 
+                == "Tue, 29 Feb 2000 00:00:00 GMT");
+        }
+    }
+
+    GIVEN("The current date") {
+
+        auto const* date = http::current_date();
+
+        THEN("It should be a NUL-terminated IMF-fixdate") {
+            REQUIRE(std::strlen(date) == http::DATE_LENGTH);
+            REQUIRE(std::string { date + 26 } == "GMT");
+        }
+
+        AND_THEN("It should be reused by later calls") {
+            REQUIRE(http::current_date() == date);
+        }
+    }
+
+    GIVEN("A response built with a date") {
+
+        auto response = http::HttpResponseBuilder { }
+            .with_protocol({ 
+                http::Version::Http11,
+                static_cast<size_t>(200),
+                "OK"
+            })
+            .with_date()
+            .build();
+
+        THEN("It should have a Date header") {
+            auto it = http::find_header(response.headers(), "date");
+            REQUIRE(it != response.headers().end());
+            REQUIRE(std::get<1>(*it).size() == http::DATE_LENGTH);
+        }
+    }
+}
@@ -0,0 +1,401 @@
+#include "http/encoding.hpp"
+#include "catch.hpp"
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    auto compress(std::string const& input, http::ContentCoding coding)
+        -> std::string
+    {
+        auto e = http::Encoder::create(coding, 6);
+        if (!e) {
+            throw std::system_error { result::error(std::move(e)) };
+        }
+
+        auto encoder = result::value(std::move(e));
+        auto output = std::string { };
+        auto const* in = reinterpret_cast<uint8_t const*>(input.data());
+        auto remaining = input.size();
+
+        while (!encoder.is_finished()) {
+            uint8_t buffer[256];
+            auto consumed = static_cast<size_t>(0);
+            auto r = encoder.encode(in, 
+                                    remaining, 
+                                    consumed, 
+                                    buffer, 
+                                    sizeof(buffer), 
+                                    http::EncodeFlush::Finish);
+            if (!r) {
+                throw std::system_error { result::error(std::move(r)) };
+            }
+
+            in += consumed;
+            remaining -= consumed;
+            output.append(reinterpret_cast<char const*>(buffer), 
+                          result::value(std::move(r)));
+        }
+
+        return output;
+    }
+
+    auto decompress(std::string const& input, http::ContentCoding coding)
+        -> std::string
+    {
+        auto d = http::Decoder::create(coding);
+        if (!d) {
+            throw std::system_error { result::error(std::move(d)) };
+        }
+
+        auto decoder = result::value(std::move(d));
+        auto output = std::string { };
+        auto const* in = reinterpret_cast<uint8_t const*>(input.data());
+        auto remaining = input.size();
+
+        while (!decoder.is_finished()) {
+            uint8_t buffer[256];
+            auto consumed = static_cast<size_t>(0);
+            auto r = decoder.decode(in, 
+                                    remaining, 
+                                    consumed, 
+                                    buffer, 
+                                    sizeof(buffer));
+            if (!r) {
+                throw std::system_error { result::error(std::move(r)) };
+            }
+
+            in += consumed;
+            remaining -= consumed;
+            output.append(reinterpret_cast<char const*>(buffer), 
+                          result::value(std::move(r)));
+        }
+
+        return output;
+    }
+
+    auto request_accepting(std::string accept) -> http::HttpRequest {
+        return http::HttpRequestBuilder { }
+            .with_protocol({ 
+                http::Method::Get, 
+                "/", 
+                http::Version::Http11 
+            })
+            .with_header({ "Accept-Encoding", std::move(accept) })
+            .build();
+    }
+}
+
+SCENARIO("Content-encoding negotiation", "[encoding]") {
+
+    GIVEN("Requests with various Accept-Encoding headers") {
+
+        THEN("The preferred, supported coding should be chosen") {
+            REQUIRE(http::negotiate_encoding(request_accepting("gzip, deflate"))
+                == http::ContentCoding::Gzip);
+            REQUIRE(http::negotiate_encoding(
+                        request_accepting("gzip;q=0.5, deflate"))
+                == http::ContentCoding::Deflate);
+            REQUIRE(http::negotiate_encoding(request_accepting("br, *;q=0.1"))
+                == http::ContentCoding::Gzip);
+            REQUIRE(http::negotiate_encoding(request_accepting("gzip;q=0"))
+                == http::ContentCoding::Identity);
+            REQUIRE(http::negotiate_encoding(request_accepting("identity"))
+                == http::ContentCoding::Identity);
+        }
+    }
+}
+
+SCENARIO("Streaming compression", "[encoding]") {
+
+    auto input = std::string { };
+    for (auto i = 0; i < 1000; ++i) {
+        input += "row " + std::to_string(i) + ": Hello, World!\n";
+    }
+
+    GIVEN("Some data") {
+
+        THEN("It should survive a round trip through each coding") {
+            for (auto coding : { http::ContentCoding::Gzip, 
+                                 http::ContentCoding::Deflate }) 
+            {
+                auto compressed = compress(input, coding);
+                REQUIRE(compressed.size() < input.size());
+                REQUIRE(decompress(compressed, coding) == input);
+            }
+        }
+    }
+
+    GIVEN("A large response") {
+
+        auto response = http::HttpResponseBuilder { }
+            .with_protocol({ 
+                http::Version::Http11,
+                static_cast<size_t>(200),
+                "OK"
+            })
+            .with_headers({
+                std::make_pair("Content-Length", std::to_string(input.size())),
+                std::make_pair("Content-Type", "text/plain")
+            })
+            .build(input.begin(), input.end());
+
+        WHEN("It is written with gzip encoding") {
+
+            auto options = http::EncodingOptions { };
+            options.chunk_size = 512;
+
+            auto os = std::ostringstream { };
+            auto r = http::write_response(os, 
+                                          response, 
+                                          http::ContentCoding::Gzip,
+                                          options);
+            REQUIRE(r.is_ok());
+
+            auto wire = os.str();
+
+            THEN("The body should be gzip encoded and chunked") {
+                REQUIRE(wire.find("Content-Encoding: gzip\r\n") 
+                    != std::string::npos);
+                REQUIRE(wire.find("Transfer-Encoding: chunked\r\n") 
+                    != std::string::npos);
+                REQUIRE(wire.find("Content-Length") == std::string::npos);
+                REQUIRE(wire.find("\r\n200\r\n") != std::string::npos);
+            }
+
+            AND_THEN("It should be decoded when parsed") {
+                auto parse_options = http::ParseOptions { };
+                parse_options.decode_content_encoding = true;
+
+                auto result = http::parse_response(wire.begin(), 
+                                                   wire.end(),
+                                                   parse_options);
+                REQUIRE(result.is_ok());
+
+                auto resp = std::get<0>(result::value(std::move(result)));
+                REQUIRE(std::string { resp.body().begin(), resp.body().end() }
+                    == input);
+                REQUIRE(http::find_header(resp.headers(), "Content-Encoding")
+                    == resp.headers().end());
+            }
+
+            AND_THEN("The decoded body should be subject to the size limit") {
+                auto parse_options = http::ParseOptions { };
+                parse_options.decode_content_encoding = true;
+                parse_options.max_body_size = input.size() - 1;
+
+                auto result = http::parse_response(wire.begin(), 
+                                                   wire.end(),
+                                                   parse_options);
+                REQUIRE(!result);
+                REQUIRE(result::error(std::move(result)) == 
+                    make_error_code(http::ParseError::BODY_TOO_LARGE));
+            }
+
+#ifndef _WIN32
+            AND_THEN("A decoded body past the spill threshold should be mapped") {
+                auto parse_options = http::ParseOptions { };
+                parse_options.decode_content_encoding = true;
+                parse_options.body_spill_threshold = 1024;
+
+                auto result = http::parse_response(wire.begin(), 
+                                                   wire.end(),
+                                                   parse_options);
+                REQUIRE(result.is_ok());
+
+                auto resp = std::get<0>(result::value(std::move(result)));
+                REQUIRE(resp.body().is_mapped());
+                REQUIRE(std::string { resp.body().begin(), resp.body().end() }
+                    == input);
+            }
+#endif
+        }
+
+        WHEN("Part of it is written and flushed") {
+
+            auto os = std::ostringstream { };
+            auto w = http::EncodingWriter<char>::create(
+                os,
+                response,
+                http::ContentCoding::Gzip);
+            REQUIRE(w.is_ok());
+
+            auto writer = result::value(std::move(w));
+            REQUIRE(writer.write(input.data(), 100).is_ok());
+            REQUIRE(writer.flush().is_ok());
+
+            THEN("A chunk that decodes to that part should be sent") {
+                auto wire = os.str();
+                auto body = wire.find("\r\n\r\n");
+                REQUIRE(body != std::string::npos);
+
+                auto size_end = wire.find("\r\n", body + 4);
+                REQUIRE(size_end != std::string::npos);
+
+                auto size = std::stoul(
+                    wire.substr(body + 4, size_end - body - 4), 
+                    nullptr, 
+                    16);
+                REQUIRE(size > 0);
+                REQUIRE(wire.size() == size_end + 2 + size + 2);
+
+                auto d = http::Decoder::create(http::ContentCoding::Gzip);
+                REQUIRE(d.is_ok());
+
+                auto decoder = result::value(std::move(d));
+                auto const* chunk = reinterpret_cast<uint8_t const*>(
+                    wire.data() + size_end + 2);
+                uint8_t buffer[256];
+                auto consumed = static_cast<size_t>(0);
+                auto r = decoder.decode(chunk, 
+                                        size, 
+                                        consumed, 
+                                        buffer, 
+                                        sizeof(buffer));
+                REQUIRE(r.is_ok());
+                REQUIRE(consumed == size);
+
+                auto decoded = std::string { 
+                    reinterpret_cast<char const*>(buffer),
+                    result::value(std::move(r))
+                };
+                REQUIRE(decoded == input.substr(0, 100));
+            }
+        }
+
+        WHEN("It is smaller than the threshold") {
+
+            auto options = http::EncodingOptions { };
+            options.threshold = input.size() + 1;
+
+            auto os = std::ostringstream { };
+            http::write_response(os, 
+                                 response, 
+                                 http::ContentCoding::Gzip,
+                                 options);
+
+            THEN("It should be written unencoded") {
+                REQUIRE(os.str().find("Content-Encoding") == std::string::npos);
+                REQUIRE(os.str().substr(os.str().size() - input.size()) 
+                    == input);
+            }
+        }
+    }
+
+    GIVEN("Responses that already have a Vary header") {
+
+        auto encoded_with_vary = [&](char const* vary) {
+            auto response = http::HttpResponseBuilder { }
+                .with_protocol({ 
+                    http::Version::Http11,
+                    static_cast<size_t>(200),
+                    "OK"
+                })
+                .with_headers({ std::make_pair("Vary", vary) })
+                .build(input.begin(), input.end());
+
+            auto os = std::ostringstream { };
+            auto r = http::write_response(os, 
+                                          response, 
+                                          http::ContentCoding::Gzip);
+            REQUIRE(r.is_ok());
+
+            auto wire = os.str();
+            return wire.substr(0, wire.find("\r\n\r\n") + 2);
+        };
+
+        WHEN("They are written with gzip encoding") {
+
+            THEN("Accept-Encoding should be added to the existing header") {
+                auto head = encoded_with_vary("Origin");
+                REQUIRE(head.find("Vary: Origin, Accept-Encoding\r\n") 
+                    != std::string::npos);
+                REQUIRE(head.find("Vary") == head.rfind("Vary"));
+            }
+
+            THEN("A header that already lists it should be left alone") {
+                auto head = encoded_with_vary("Origin, accept-encoding");
+                REQUIRE(head.find("Vary: Origin, accept-encoding\r\n") 
+                    != std::string::npos);
+                REQUIRE(head.find("Vary") == head.rfind("Vary"));
+
+                head = encoded_with_vary("*");
+                REQUIRE(head.find("Vary: *\r\n") != std::string::npos);
+                REQUIRE(head.find("Vary") == head.rfind("Vary"));
+            }
+        }
+    }
+
+    GIVEN("A gzip encoded request") {
+
+        auto body = compress(input, http::ContentCoding::Gzip);
+        auto wire = std::string { "POST /upload HTTP/1.1\r\n" } + 
+            "Content-Encoding: gzip\r\n" +
+            "Content-Length: " + std::to_string(body.size()) + 
+            "\r\n\r\n" + body;
+
+        WHEN("Only its body is captured, with decoding enabled") {
+
+            auto options = http::ParseOptions { };
+            options.decode_content_encoding = true;
+
+            auto result = http::parse_request<http::Capture::Body>(
+                wire.begin(),
+                wire.end(),
+                options);
+
+            THEN("The body should still be decoded") {
+                REQUIRE(result.is_ok());
+
+                auto req = std::get<0>(result::value(std::move(result)));
+                REQUIRE(req.headers().empty());
+                REQUIRE(std::string { req.body().begin(), req.body().end() }
+                    == input);
+            }
+        }
+    }
+
+    GIVEN("Bodies made of more than one compressed stream") {
+
+        auto first = input.substr(0, 100);
+        auto second = input.substr(100);
+
+        auto parse = [&](http::ContentCoding coding) {
+            auto body = compress(first, coding) + compress(second, coding);
+            auto wire = std::string { "HTTP/1.1 200 OK\r\n" } + 
+                "Content-Encoding: " + http::detail::coding_name(coding) + 
+                "\r\n" +
+                "Content-Length: " + std::to_string(body.size()) + 
+                "\r\n\r\n" + body;
+
+            auto options = http::ParseOptions { };
+            options.decode_content_encoding = true;
+            return http::parse_response(wire.begin(), wire.end(), options);
+        };
+
+        WHEN("They are gzip members") {
+
+            auto result = parse(http::ContentCoding::Gzip);
+
+            THEN("Each member should be decoded in turn") {
+                REQUIRE(result.is_ok());
+
+                auto resp = std::get<0>(result::value(std::move(result)));
+                REQUIRE(std::string { resp.body().begin(), resp.body().end() }
+                    == input);
+            }
+        }
+
+        WHEN("They are deflate streams") {
+
+            auto result = parse(http::ContentCoding::Deflate);
+
+            THEN("The data after the first stream should be rejected") {
+                REQUIRE(!result);
+                REQUIRE(result::error(std::move(result)) == 
+                    make_error_code(
+                        http::ParseError::INVALID_CONTENT_ENCODING));
+            }
+        }
+    }
+}
@@ -1,4 +1,6 @@
 #include "http/error.hpp"
+#include "http/http.hpp"
+#include <string>
 #include "catch.hpp"
 
 SCENARIO("Parse errors", "[error]") {
@@ -21,3 +23,44 @@ SCENARIO("Parse errors", "[error]") {
         }
     }
 }
+
+SCENARIO("Parse error counters", "[error]") {
+
+    GIVEN("Counters that have been reset") {
+
+        http::reset_parse_error_counts();
+
+        WHEN("Parsing fails") {
+
+            std::string const invalid = "GET / HTTP/1.1\r\nHost: a\r\n";
+            http::parse_request(invalid.begin(), invalid.end());
+            http::parse_request(invalid.begin(), invalid.end());
+
+            THEN("The failures should be counted by kind") {
+                REQUIRE(http::parse_error_count(
+                    http::ParseError::INVALID_EOF_STATE) == 2);
+                REQUIRE(http::parse_error_count(
+                    http::ParseError::INVALID_METHOD) == 0);
+
+                auto counts = http::parse_error_counts();
+                REQUIRE(counts.size() == 1);
+                REQUIRE(counts[0].error == http::ParseError::INVALID_EOF_STATE);
+                REQUIRE(counts[0].count == 2);
+            }
+        }
+
+        WHEN("A library-defined error occurs") {
+
+            std::string const request = 
+                "GET / HTTP/1.1\r\nA: 1\r\nB: 2\r\n\r\n";
+            auto options = http::ParseOptions { };
+            options.max_header_count = 1;
+            http::parse_request(request.begin(), request.end(), options);
+
+            THEN("It should be counted too") {
+                REQUIRE(http::parse_error_count(
+                    http::ParseError::TOO_MANY_HEADERS) == 1);
+            }
+        }
+    }
+}
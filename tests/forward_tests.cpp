@@ -0,0 +1,135 @@
+#include "http/http.hpp"
+#include "http/forward.hpp"
+#include "catch.hpp"
+#include <string>
+
+namespace {
+
+    auto flatten(http::ForwardedMessage const& message) -> std::string {
+        auto out = std::string { };
+        for (auto const& b : message.buffers()) {
+            out.append(static_cast<char const*>(b.data), b.size);
+        }
+
+        return out;
+    }
+}
+
+SCENARIO("Forwarding messages", "[forward]") {
+
+    GIVEN("A parsed request with hop-by-hop headers") {
+        std::string const HTTP_REQUEST = 
+            "POST /upload HTTP/1.1\r\n"
+            "Host: example.com\r\n"
+            "Connection: keep-alive, X-Secret\r\n"
+            "Keep-Alive: timeout=5\r\n"
+            "X-Forwarded-For: 10.0.0.1\r\n"
+            "X-Secret: hunter2\r\n"
+            "Content-Type: text/plain\r\n"
+            "Content-Length: 13\r\n"
+            "\r\n"
+            "Hello, World!";
+
+        auto result = http::parse_request(HTTP_REQUEST.begin(), 
+                                          HTTP_REQUEST.end());
+        REQUIRE(result.is_ok());
+        auto parsed = result::value(std::move(result));
+
+        WHEN("It is forwarded without edits") {
+
+            auto message = http::forward_request(HTTP_REQUEST.data(),
+                                                 std::get<1>(parsed),
+                                                 std::get<0>(parsed));
+
+            THEN("Hop-by-hop headers should be removed") {
+                REQUIRE(flatten(message) == 
+                    "POST /upload HTTP/1.1\r\n"
+                    "Host: example.com\r\n"
+                    "X-Forwarded-For: 10.0.0.1\r\n"
+                    "Content-Type: text/plain\r\n"
+                    "Content-Length: 13\r\n"
+                    "\r\n"
+                    "Hello, World!");
+                REQUIRE(message.size() == flatten(message).size());
+            }
+
+            AND_THEN("Unchanged spans should refer to the original bytes") {
+                auto const& buffers = message.buffers();
+                REQUIRE(buffers.size() == 3);
+                REQUIRE(buffers[0].data == HTTP_REQUEST.data());
+                REQUIRE(static_cast<char const*>(buffers.back().data) + 
+                            buffers.back().size == 
+                        HTTP_REQUEST.data() + HTTP_REQUEST.size());
+            }
+        }
+
+        WHEN("It is forwarded with edits") {
+
+            auto options = http::ForwardOptions { };
+            options.forwarded_for = "192.168.1.7";
+            options.remove.push_back("content-type");
+            options.add.emplace_back("Via", "1.1 proxy");
+
+            auto message = http::forward_request(HTTP_REQUEST.data(),
+                                                 std::get<1>(parsed),
+                                                 std::get<0>(parsed),
+                                                 options);
+
+            THEN("The edits should be spliced into the original bytes") {
+                REQUIRE(flatten(message) == 
+                    "POST /upload HTTP/1.1\r\n"
+                    "Host: example.com\r\n"
+                    "Content-Length: 13\r\n"
+                    "X-Forwarded-For: 10.0.0.1, 192.168.1.7\r\n"
+                    "Via: 1.1 proxy\r\n"
+                    "\r\n"
+                    "Hello, World!");
+            }
+
+            AND_THEN("It should survive being moved") {
+                auto moved = std::move(message);
+                REQUIRE(flatten(moved).find("Via: 1.1 proxy\r\n") 
+                    != std::string::npos);
+            }
+        }
+    }
+
+    GIVEN("A parsed chunked response") {
+        std::string const HTTP_RESPONSE = 
+            "HTTP/1.1 200 OK\r\n"
+            "Connection: close\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "\r\n"
+            "5\r\n"
+            "Hello\r\n"
+            "0\r\n"
+            "\r\n";
+
+        auto result = http::parse_response(HTTP_RESPONSE.begin(), 
+                                           HTTP_RESPONSE.end());
+        REQUIRE(result.is_ok());
+        auto parsed = result::value(std::move(result));
+
+        WHEN("It is forwarded") {
+
+            auto options = http::ForwardOptions { };
+            options.forwarded_for = "ignored";
+
+            auto message = http::forward_response(HTTP_RESPONSE.data(),
+                                                  std::get<1>(parsed),
+                                                  std::get<0>(parsed),
+                                                  options);
+
+            THEN("The body should keep its original framing") {
+                REQUIRE(flatten(message) == 
+                    "HTTP/1.1 200 OK\r\n"
+                    "Transfer-Encoding: chunked\r\n"
+                    "\r\n"
+                    "5\r\n"
+                    "Hello\r\n"
+                    "0\r\n"
+                    "\r\n");
+            }
+        }
+    }
+}
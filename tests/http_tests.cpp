@@ -3,6 +3,7 @@
 #include "catch.hpp"
 #include <streambuf>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <functional>
 #include <cassert>
@@ -114,6 +115,42 @@ Content-Length: 0
             }
         }
     }
+
+    GIVEN("Two pipelined requests in one buffer") {
+        std::string const HTTP_REQUESTS = 
+            "GET /first HTTP/1.1\r\n"
+            "Host: example.com\r\n"
+            "\r\n"
+            "POST /second HTTP/1.1\r\n"
+            "Content-Length: 5\r\n"
+            "\r\n"
+            "Hello";
+
+        WHEN("They are parsed one after the other") {
+            auto first = http::parse_request(HTTP_REQUESTS.begin(),
+                                             HTTP_REQUESTS.end());
+            REQUIRE(first.is_ok());
+            auto first_request = result::value(std::move(first));
+            auto const consumed = std::get<1>(first_request);
+
+            auto second = http::parse_request(
+                HTTP_REQUESTS.begin() + consumed,
+                HTTP_REQUESTS.end());
+            REQUIRE(second.is_ok());
+            auto second_request = result::value(std::move(second));
+
+            THEN("Each should contain only its own message") {
+                REQUIRE(std::get<0>(first_request).path() == "/first");
+                REQUIRE(std::get<0>(first_request).headers().size() == 1);
+                REQUIRE(consumed == HTTP_REQUESTS.find("POST"));
+
+                REQUIRE(std::get<0>(second_request).path() == "/second");
+                REQUIRE(std::get<0>(second_request).headers().size() == 1);
+                REQUIRE(consumed + std::get<1>(second_request) == 
+                    HTTP_REQUESTS.size());
+            }
+        }
+    }
 }
 
 template<typename T, typename Traits = std::char_traits<T>>
@@ -238,4 +275,553 @@ SCENARIO("HTTP serialization", "[serialization]") {
             }
         }
     }
+
+    GIVEN("A user-created HTTP request") {
+
+        auto content = std::string { "Hello" };
+        auto request = http::HttpRequestBuilder { }
+            .with_protocol({ 
+                http::Method::Put,
+                "/files/greeting",
+                http::Version::Http11
+            })
+            .with_headers({
+                std::make_pair("Host", "example.com"),
+                std::make_pair("Content-Length", std::to_string(content.size()))
+            })
+            .build(content.begin(), content.end());
+
+        WHEN("It is serialized") {
+            auto os = std::ostringstream { };
+            os << request;
+            auto const bytes = os.str();
+
+            THEN("It should have the expected byte representation") {
+                REQUIRE(bytes == 
+                    "PUT /files/greeting HTTP/1.1\r\n"
+                    "Host: example.com\r\n"
+                    "Content-Length: 5\r\n"
+                    "\r\n"
+                    "Hello");
+            }
+
+            THEN("It should parse back to the same request") {
+                auto result = http::parse_request(bytes.begin(), bytes.end());
+                REQUIRE(result.is_ok());
+
+                auto parsed = std::get<0>(result::value(std::move(result)));
+                REQUIRE(parsed.method() == http::Method::Put);
+                REQUIRE(parsed.path() == "/files/greeting");
+                REQUIRE(parsed.headers() == request.headers());
+            }
+        }
+    }
+}
+
+SCENARIO("HTTP parsing limits", "[http][limits]") {
+
+    auto parse = [](std::string const& bytes, http::ParseOptions const& o) {
+        return http::parse_request(bytes.begin(), bytes.end(), o);
+    };
+
+    auto error_of = [](auto&& result) {
+        REQUIRE(!result);
+        return result::error(std::move(result));
+    };
+
+    GIVEN("A request with several headers and a body") {
+        std::string const HTTP_REQUEST = 
+            "POST /upload/file HTTP/1.1\r\n"
+            "Host: example.com\r\n"
+            "Accept: */*\r\n"
+            "Content-Length: 13\r\n"
+            "\r\n"
+            "Hello, World!";
+
+        auto options = http::ParseOptions { };
+
+        WHEN("It is within every limit") {
+            options.max_header_count = 3;
+            options.max_body_size = 13;
+            options.max_url_length = 12;
+
+            THEN("It should parse") {
+                REQUIRE(parse(HTTP_REQUEST, options).is_ok());
+            }
+        }
+
+        WHEN("It has too many headers") {
+            options.max_header_count = 2;
+
+            THEN("It should fail with TOO_MANY_HEADERS") {
+                REQUIRE(error_of(parse(HTTP_REQUEST, options)) == 
+                    make_error_code(http::ParseError::TOO_MANY_HEADERS));
+            }
+        }
+
+        WHEN("Its headers are too large") {
+            options.max_header_bytes = 32;
+
+            THEN("It should fail with HEADERS_TOO_LARGE") {
+                REQUIRE(error_of(parse(HTTP_REQUEST, options)) == 
+                    make_error_code(http::ParseError::HEADERS_TOO_LARGE));
+            }
+        }
+
+        WHEN("Its request-target is too long") {
+            options.max_url_length = 11;
+
+            THEN("It should fail with URL_TOO_LONG") {
+                REQUIRE(error_of(parse(HTTP_REQUEST, options)) == 
+                    make_error_code(http::ParseError::URL_TOO_LONG));
+            }
+        }
+
+        WHEN("Its body is too large") {
+            options.max_body_size = 12;
+
+            THEN("It should fail with BODY_TOO_LARGE") {
+                REQUIRE(error_of(parse(HTTP_REQUEST, options)) == 
+                    make_error_code(http::ParseError::BODY_TOO_LARGE));
+            }
+        }
+    }
+
+    GIVEN("A request with many headers and a long request-target") {
+        auto request = "GET /" + std::string(16 * 1024, 'a') + " HTTP/1.1\r\n";
+        for (auto i = 0; i < 200; ++i) {
+            request += "X-Header-" + std::to_string(i) + ": value\r\n";
+        }
+        request += "\r\n";
+
+        WHEN("It is parsed with the default limits") {
+            auto result = parse(request, http::ParseOptions { });
+
+            THEN("It should parse") {
+                REQUIRE(result.is_ok());
+                auto parsed = std::get<0>(result::value(std::move(result)));
+                REQUIRE(parsed.headers().size() == 200);
+            }
+        }
+    }
+
+    GIVEN("A chunked response whose body exceeds the limit") {
+        std::string const HTTP_RESPONSE = 
+            "HTTP/1.1 200 OK\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "\r\n"
+            "5\r\n"
+            "Hello\r\n"
+            "8\r\n"
+            ", World!\r\n"
+            "0\r\n"
+            "\r\n";
+
+        auto options = http::ParseOptions { };
+        options.max_body_size = 10;
+
+        WHEN("It is parsed") {
+            auto result = http::parse_response(HTTP_RESPONSE.begin(),
+                                               HTTP_RESPONSE.end(),
+                                               options);
+
+            THEN("It should fail with BODY_TOO_LARGE") {
+                REQUIRE(error_of(std::move(result)) == 
+                    make_error_code(http::ParseError::BODY_TOO_LARGE));
+            }
+        }
+    }
+}
+
+SCENARIO("Batch HTTP parsing", "[http][batch]") {
+
+    GIVEN("Buffers from several connections") {
+        std::string const buffers[] = {
+            "GET /first HTTP/1.1\r\n"
+            "Host: example.com\r\n"
+            "\r\n",
+
+            "POST /second HTTP/1.1\r\n"
+            "Host: example.com\r\n"
+            "Content-Length: 5\r\n"
+            "\r\n"
+            "Hello",
+
+            "NOT A REQUEST\r\n\r\n",
+
+            "DELETE /fourth HTTP/1.1\r\n"
+            "\r\n",
+        };
+
+        int contexts[4] = { };
+        auto jobs = std::vector<http::ParseJob> { };
+        for (size_t i = 0; i < 4; ++i) {
+            jobs.push_back({ buffers[i].data(), buffers[i].size(), &contexts[i] });
+        }
+
+        WHEN("They are parsed as a batch") {
+
+            auto results = std::vector<
+                http::ParseResult<std::pair<http::HttpRequest, size_t>>> { };
+            http::parse_requests(jobs.data(), jobs.size(), results);
+
+            THEN("There should be a result for each job, in order") {
+                REQUIRE(results.size() == 4);
+
+                REQUIRE(results[0].is_ok());
+                auto first = result::value(std::move(results[0]));
+                REQUIRE(std::get<0>(first).path() == "/first");
+                REQUIRE(std::get<1>(first) == buffers[0].size());
+
+                REQUIRE(results[1].is_ok());
+                auto second = result::value(std::move(results[1]));
+                REQUIRE(std::get<0>(second).method() == http::Method::Post);
+                REQUIRE(std::string { 
+                            std::get<0>(second).body().begin(),
+                            std::get<0>(second).body().end() 
+                        } == "Hello");
+
+                REQUIRE(!results[2]);
+
+                REQUIRE(results[3].is_ok());
+                auto fourth = result::value(std::move(results[3]));
+                REQUIRE(std::get<0>(fourth).path() == "/fourth");
+                REQUIRE(std::get<0>(fourth).headers().empty());
+            }
+        }
+
+        WHEN("A second batch is parsed into the same results") {
+
+            auto results = std::vector<
+                http::ParseResult<std::pair<http::HttpRequest, size_t>>> { };
+            http::parse_requests(jobs.data(), 2, results);
+            http::parse_requests(jobs.data() + 2, 2, results);
+
+            THEN("The results should be appended") {
+                REQUIRE(results.size() == 4);
+                REQUIRE(results[1].is_ok());
+                REQUIRE(!results[2]);
+                REQUIRE(results[3].is_ok());
+            }
+        }
+    }
+}
+
+SCENARIO("In-place HTTP parsing", "[http][in-place]") {
+
+    GIVEN("A chunked request in a mutable buffer") {
+        auto buffer = std::string {
+            "POST /upload HTTP/1.1\r\n"
+            "Host: example.com\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "\r\n"
+            "5\r\n"
+            "Hello\r\n"
+            "8\r\n"
+            ", World!\r\n"
+            "0\r\n"
+            "\r\n"
+        };
+
+        WHEN("It is parsed in place") {
+            auto result = http::parse_request_in_place(buffer.begin(), 
+                                                       buffer.end());
+            REQUIRE(result.is_ok());
+
+            auto parsed = result::value(std::move(result));
+            auto const& body = std::get<0>(parsed).body();
+
+            THEN("The body should be a contiguous view into the buffer") {
+                REQUIRE(body.is_view());
+                REQUIRE(std::string { body.begin(), body.end() } == 
+                    "Hello, World!");
+
+                auto const* first = reinterpret_cast<uint8_t const*>(
+                    buffer.data());
+                REQUIRE(body.data() > first);
+                REQUIRE(body.end() <= first + buffer.size());
+            }
+
+            THEN("The rest of the request should be parsed as usual") {
+                REQUIRE(std::get<1>(parsed) == buffer.size());
+                REQUIRE(std::get<0>(parsed).path() == "/upload");
+                REQUIRE(std::get<0>(parsed).headers().size() == 2);
+            }
+        }
+
+        WHEN("A copy of it is parsed normally") {
+            auto const copy = buffer;
+            auto result = http::parse_request(copy.begin(), copy.end());
+            REQUIRE(result.is_ok());
+
+            auto parsed = result::value(std::move(result));
+            auto const& body = std::get<0>(parsed).body();
+
+            THEN("The body should be copied into storage of its own") {
+                REQUIRE(!body.is_view());
+                REQUIRE(std::string { body.begin(), body.end() } == 
+                    "Hello, World!");
+            }
+        }
+    }
+
+    GIVEN("A response with a Content-Length body in a mutable buffer") {
+        auto buffer = std::vector<char> { };
+        auto const text = std::string {
+            "HTTP/1.1 200 OK\r\n"
+            "Content-Length: 5\r\n"
+            "\r\n"
+            "Hello"
+        };
+        buffer.assign(text.begin(), text.end());
+
+        WHEN("It is parsed in place") {
+            auto result = http::parse_response_in_place(buffer.begin(),
+                                                        buffer.end());
+            REQUIRE(result.is_ok());
+
+            auto parsed = result::value(std::move(result));
+            auto const& body = std::get<0>(parsed).body();
+
+            THEN("The body should refer to the buffer, unchanged") {
+                REQUIRE(body.is_view());
+                REQUIRE(body.data() == reinterpret_cast<uint8_t const*>(
+                    buffer.data() + text.size() - 5));
+                REQUIRE(std::string { buffer.begin(), buffer.end() } == text);
+            }
+        }
+    }
+}
+
+SCENARIO("HTTP parse capture profiles", "[http][capture]") {
+
+    GIVEN("A request with a path, headers and a body") {
+        std::string const HTTP_REQUEST = 
+            "POST /orders/42 HTTP/1.1\r\n"
+            "Host: example.com\r\n"
+            "Content-Length: 5\r\n"
+            "\r\n"
+            "Hello";
+
+        WHEN("Only the path is captured") {
+            auto result = http::parse_request<http::Capture::Path>(
+                HTTP_REQUEST.begin(),
+                HTTP_REQUEST.end());
+            REQUIRE(result.is_ok());
+            auto parsed = result::value(std::move(result));
+            auto const& request = std::get<0>(parsed);
+
+            THEN("The headers and body should be empty") {
+                REQUIRE(request.method() == http::Method::Post);
+                REQUIRE(request.path() == "/orders/42");
+                REQUIRE(request.headers().empty());
+                REQUIRE(request.body().empty());
+            }
+
+            THEN("The whole request should still be consumed") {
+                REQUIRE(std::get<1>(parsed) == HTTP_REQUEST.size());
+            }
+        }
+
+        WHEN("The headers and body are captured") {
+            auto result = http::parse_request<
+                http::Capture::Headers | http::Capture::Body>(
+                    HTTP_REQUEST.begin(),
+                    HTTP_REQUEST.end());
+            REQUIRE(result.is_ok());
+            auto parsed = result::value(std::move(result));
+            auto const& request = std::get<0>(parsed);
+
+            THEN("The path should be empty") {
+                REQUIRE(request.path().empty());
+                REQUIRE(request.headers().size() == 2);
+                REQUIRE(std::string { 
+                            request.body().begin(), 
+                            request.body().end() 
+                        } == "Hello");
+            }
+        }
+
+        WHEN("Nothing is captured, with a header limit") {
+            auto options = http::ParseOptions { };
+            options.max_header_count = 1;
+
+            auto result = http::parse_request<http::Capture::None>(
+                HTTP_REQUEST.begin(),
+                HTTP_REQUEST.end(),
+                options);
+
+            THEN("The limit should still apply") {
+                REQUIRE(!result);
+                REQUIRE(result::error(std::move(result)) == 
+                    make_error_code(http::ParseError::TOO_MANY_HEADERS));
+            }
+        }
+    }
+}
+
+SCENARIO("HTTP message mutation", "[http][mutation]") {
+
+    GIVEN("A parsed request") {
+        constexpr char HTTP_REQUEST[] = 
+            "POST /upload HTTP/1.1\r\n"
+            "Host: example.com\r\n"
+            "Connection: keep-alive\r\n"
+            "X-Trace: a\r\n"
+            "Content-Length: 5\r\n"
+            "x-trace: b\r\n"
+            "\r\n"
+            "Hello";
+
+        using std::begin;
+        using std::end;
+
+        auto result = http::parse_request(begin(HTTP_REQUEST), 
+                                          end(HTTP_REQUEST)-1);
+        REQUIRE(result.is_ok());
+        auto request = std::get<0>(result::value(std::move(result)));
+
+        WHEN("A header is set") {
+
+            request.set_header("x-TRACE", "c");
+            request.set_header("Via", "1.1 proxy");
+
+            THEN("Existing headers with that name should be replaced") {
+                auto const& headers = request.headers();
+                REQUIRE(headers.size() == 5);
+                REQUIRE(std::get<0>(headers[2]) == "X-Trace");
+                REQUIRE(std::get<1>(headers[2]) == "c");
+                REQUIRE(std::get<0>(headers[4]) == "Via");
+                REQUIRE(std::get<1>(headers[4]) == "1.1 proxy");
+            }
+        }
+
+        WHEN("A header is removed") {
+
+            auto n = request.remove_header("X-Trace");
+
+            THEN("Every header with that name should be gone") {
+                REQUIRE(n == 2);
+                REQUIRE(request.headers().size() == 3);
+                REQUIRE(http::find_header(request.headers(), "X-Trace") 
+                    == request.headers().end());
+                REQUIRE(request.remove_header("X-Trace") == 0);
+            }
+        }
+
+        WHEN("The body is replaced") {
+
+            auto const replacement = std::string { "Goodbye, World!" };
+            request.set_body(http::BodyContainer { 
+                replacement.begin(), 
+                replacement.end() 
+            });
+
+            THEN("The Content-Length header should match it") {
+                REQUIRE(request.body().size() == replacement.size());
+                REQUIRE(std::get<1>(*http::find_header(request.headers(),
+                                                       "Content-Length")) 
+                    == "15");
+            }
+        }
+
+        WHEN("Its headers and body are taken") {
+
+            auto const* body_data = request.body().data();
+            auto headers = std::move(request).take_headers();
+            auto body = std::move(request).take_body();
+
+            THEN("They should be moved, not copied") {
+                REQUIRE(headers.size() == 5);
+                REQUIRE(body.data() == body_data);
+                REQUIRE(std::string { body.begin(), body.end() } == "Hello");
+            }
+        }
+    }
+}
+
+SCENARIO("HTTP parse diagnostics", "[http][diagnostics]") {
+
+    GIVEN("A request with too many headers") {
+        std::string const HTTP_REQUEST = 
+            "GET /index HTTP/1.1\r\n"
+            "Host: example.com\r\n"
+            "Accept: */*\r\n"
+            "\r\n";
+
+        auto diagnostics = http::ParseDiagnostics { };
+        auto options = http::ParseOptions { };
+        options.max_header_count = 1;
+        options.diagnostics = &diagnostics;
+
+        WHEN("It is parsed") {
+
+            auto result = http::parse_request(HTTP_REQUEST.begin(),
+                                              HTTP_REQUEST.end(),
+                                              options);
+
+            THEN("The diagnostics should describe the failure") {
+                REQUIRE(!result);
+                REQUIRE(diagnostics.error == 
+                    make_error_code(http::ParseError::TOO_MANY_HEADERS));
+                REQUIRE(diagnostics.error == result::error(std::move(result)));
+                REQUIRE(std::string { diagnostics.phase } == "headers");
+                REQUIRE(diagnostics.line == 3);
+                REQUIRE(diagnostics.offset <= HTTP_REQUEST.size());
+                REQUIRE(!diagnostics.excerpt.empty());
+            }
+        }
+    }
+
+    GIVEN("A truncated request") {
+        std::string const HTTP_REQUEST = 
+            "POST /index HTTP/1.1\r\n"
+            "Content-Length: 10\r\n"
+            "\r\n"
+            "abc";
+
+        auto diagnostics = http::ParseDiagnostics { };
+        auto options = http::ParseOptions { };
+        options.diagnostics = &diagnostics;
+
+        WHEN("It is parsed") {
+
+            auto result = http::parse_request(HTTP_REQUEST.begin(),
+                                              HTTP_REQUEST.end(),
+                                              options);
+
+            THEN("The failure should be at the end of the body") {
+                REQUIRE(!result);
+                REQUIRE(diagnostics.offset == HTTP_REQUEST.size());
+                REQUIRE(diagnostics.byte == -1);
+                REQUIRE(std::string { diagnostics.phase } == "body");
+                REQUIRE(diagnostics.line == 4);
+                REQUIRE(diagnostics.column == 4);
+                REQUIRE(diagnostics.excerpt == "ength: 10\\r\\n\\r\\nabc");
+            }
+        }
+    }
+
+    GIVEN("A valid request") {
+        std::string const HTTP_REQUEST = 
+            "GET / HTTP/1.1\r\n"
+            "\r\n";
+
+        auto diagnostics = http::ParseDiagnostics { };
+        auto options = http::ParseOptions { };
+        options.diagnostics = &diagnostics;
+
+        WHEN("It is parsed") {
+
+            auto result = http::parse_request(HTTP_REQUEST.begin(),
+                                              HTTP_REQUEST.end(),
+                                              options);
+
+            THEN("The diagnostics should be untouched") {
+                REQUIRE(result.is_ok());
+                REQUIRE(!diagnostics.error);
+                REQUIRE(diagnostics.line == 0);
+            }
+        }
+    }
 }
@@ -0,0 +1,125 @@
+#include "http/mapped_file.hpp"
+#include "http/http.hpp"
+#include "catch.hpp"
+#include <algorithm>
+#include <string>
+
+#ifndef _WIN32
+SCENARIO("Memory-mapped bodies", "[mapped_file]") {
+
+    GIVEN("A temporary mapped file") {
+
+        auto file = http::MappedFile::create_temporary(4096);
+
+        if (!file) {
+            throw std::system_error { result::error(std::move(file)) };
+        }
+
+        auto mapped = result::value(std::move(file));
+
+        THEN("It should be writable and have the requested size") {
+            REQUIRE(mapped.is_mapped());
+            REQUIRE(mapped.size() == 4096);
+
+            std::fill(mapped.data(), mapped.data() + mapped.size(), 'x');
+            REQUIRE(mapped.data()[4095] == 'x');
+        }
+
+        WHEN("It is used to build a response") {
+
+            constexpr char CONTENT[] = "Hello, World!";
+            std::copy(std::begin(CONTENT), std::end(CONTENT)-1, mapped.data());
+
+            auto response = http::HttpResponseBuilder { }
+                .with_protocol({ 
+                    http::Version::Http11,
+                    static_cast<size_t>(200),
+                    "OK"
+                })
+                .build(std::move(mapped));
+
+            THEN("The body should refer to the mapping") {
+                REQUIRE(response.body().is_mapped());
+                REQUIRE(response.body().size() == 4096);
+                REQUIRE(std::string { 
+                            response.body().begin(), 
+                            response.body().begin() + 13 
+                        } == "Hello, World!");
+            }
+        }
+    }
+
+    GIVEN("A temporary file") {
+
+        auto file = http::TemporaryFile::create();
+
+        if (!file) {
+            throw std::system_error { result::error(std::move(file)) };
+        }
+
+        auto temporary = result::value(std::move(file));
+
+        WHEN("It is written to in pieces, then mapped") {
+            REQUIRE(!temporary.write("Hello, ", 7));
+            REQUIRE(!temporary.write("World!", 6));
+            REQUIRE(temporary.size() == 13);
+
+            auto mapped = std::move(temporary).map();
+            REQUIRE(mapped.is_ok());
+
+            THEN("The mapping should hold everything that was written") {
+                auto m = result::value(std::move(mapped));
+                REQUIRE(m.size() == 13);
+                REQUIRE(std::string { m.data(), m.data() + m.size() } 
+                    == "Hello, World!");
+                REQUIRE(!temporary.is_open());
+            }
+        }
+
+        WHEN("Nothing is written to it before it is mapped") {
+            auto mapped = std::move(temporary).map();
+
+            THEN("The mapping should be empty") {
+                REQUIRE(mapped.is_ok());
+                REQUIRE(!result::value(std::move(mapped)).is_mapped());
+            }
+        }
+    }
+
+    GIVEN("A request with a body larger than the spill threshold") {
+        constexpr char HTTP_REQUEST[] = 
+            "POST /upload HTTP/1.1\r\n"
+            "Host: example.com\r\n"
+            "Content-Length: 13\r\n"
+            "\r\n"
+            "Hello, World!";
+
+        WHEN("It is parsed") {
+            using std::begin;
+            using std::end;
+
+            auto options = http::ParseOptions { };
+            options.body_spill_threshold = 8;
+
+            auto result = http::parse_request(
+                begin(HTTP_REQUEST),
+                end(HTTP_REQUEST)-1,
+                options
+            );
+
+            if (!result) {
+                throw std::system_error { result::error(std::move(result)) };
+            }
+
+            THEN("The body should be held in a mapped file") {
+                auto request = std::get<0>(result::value(std::move(result)));
+                REQUIRE(request.body().is_mapped());
+                REQUIRE(std::string { 
+                            request.body().begin(), 
+                            request.body().end() 
+                        } == "Hello, World!");
+            }
+        }
+    }
+}
+#endif
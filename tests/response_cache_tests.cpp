@@ -0,0 +1,359 @@
+#include "http/response_cache.hpp"
+#include "http/date.hpp"
+#include "catch.hpp"
+#include <string>
+
+namespace {
+    auto make_request(http::HttpRequestHeaderBuilder builder) 
+        -> http::HttpRequest 
+    {
+        return std::move(builder).build();
+    }
+
+    auto get(std::string path) -> http::HttpRequestHeaderBuilder {
+        return http::HttpRequestBuilder { }
+            .with_protocol({ 
+                http::Method::Get, 
+                std::move(path), 
+                http::Version::Http11 
+            });
+    }
+
+    auto ok(http::HeaderContainer headers, std::string const& body)
+        -> http::HttpResponse
+    {
+        return http::HttpResponseBuilder { }
+            .with_protocol({ 
+                http::Version::Http11,
+                static_cast<size_t>(200),
+                "OK"
+            })
+            .with_headers(std::move(headers))
+            .build(body.begin(), body.end());
+    }
+}
+
+SCENARIO("Response caching", "[response_cache]") {
+
+    using Clock = http::ResponseCache::Clock;
+    auto const now = Clock::now();
+
+    GIVEN("A cache holding a cacheable response") {
+
+        http::ResponseCache cache { };
+        auto response = ok({
+                std::make_pair("Cache-Control", "public, max-age=60"),
+                std::make_pair("ETag", "\"v1\""),
+                std::make_pair("Content-Length", "5")
+            }, 
+            "Hello");
+
+        REQUIRE(cache.store(make_request(get("/index")), response, now));
+        REQUIRE(cache.size_bytes() > 0);
+
+        WHEN("The same resource is requested") {
+
+            auto lookup = cache.lookup(make_request(get("/index")), now);
+
+            THEN("It should be a hit containing the serialized response") {
+                REQUIRE(lookup.status == http::CacheStatus::Hit);
+                REQUIRE(lookup.bytes);
+                REQUIRE(lookup.bytes->find("HTTP/1.1 200 OK\r\n") == 0);
+                REQUIRE(lookup.bytes->substr(lookup.bytes->size() - 5) 
+                    == "Hello");
+            }
+        }
+
+        WHEN("A different resource is requested") {
+
+            auto lookup = cache.lookup(make_request(get("/other")), now);
+
+            THEN("It should be a miss") {
+                REQUIRE(lookup.status == http::CacheStatus::Miss);
+                REQUIRE(!lookup.bytes);
+            }
+        }
+
+        WHEN("A conditional request with a matching ETag is made") {
+
+            auto lookup = cache.lookup(
+                make_request(
+                    get("/index")
+                        .with_header({ "If-None-Match", "W/\"v0\", W/\"v1\"" })),
+                now);
+
+            THEN("It should be answered with 304 Not Modified") {
+                REQUIRE(lookup.status == http::CacheStatus::NotModified);
+                REQUIRE(lookup.bytes->find("HTTP/1.1 304 Not Modified\r\n") 
+                    == 0);
+                REQUIRE(lookup.bytes->find("ETag: \"v1\"\r\n") 
+                    != std::string::npos);
+            }
+        }
+
+        WHEN("The response has expired") {
+
+            auto lookup = cache.lookup(make_request(get("/index")), 
+                                       now + std::chrono::seconds { 61 });
+
+            THEN("It should be a miss, and be evicted") {
+                REQUIRE(lookup.status == http::CacheStatus::Miss);
+                REQUIRE(cache.size_bytes() == 0);
+            }
+        }
+
+        WHEN("The request asks to bypass the cache") {
+
+            auto lookup = cache.lookup(
+                make_request(
+                    get("/index").with_header({ "Cache-Control", "no-cache" })),
+                now);
+
+            THEN("It should be a miss") {
+                REQUIRE(lookup.status == http::CacheStatus::Miss);
+            }
+        }
+    }
+
+    GIVEN("Responses that must not be cached") {
+
+        http::ResponseCache cache { };
+
+        THEN("They should not be stored") {
+            REQUIRE(!cache.store(
+                make_request(get("/")), 
+                ok({ std::make_pair("Cache-Control", "no-store") }, ""),
+                now));
+
+            REQUIRE(!cache.store(
+                make_request(get("/")), 
+                ok({ std::make_pair("Content-Length", "0") }, ""),
+                now));
+
+            REQUIRE(!cache.store(
+                make_request(get("/")), 
+                ok({ 
+                    std::make_pair("Cache-Control", "max-age=60"),
+                    std::make_pair("Vary", "*")
+                }, ""),
+                now));
+
+            REQUIRE(cache.size_bytes() == 0);
+        }
+    }
+
+    GIVEN("A response that varies on a request header") {
+
+        http::ResponseCache cache { };
+        auto vary = [](std::string const& body) {
+            return ok({
+                    std::make_pair("Cache-Control", "max-age=60"),
+                    std::make_pair("Vary", "Accept-Language")
+                }, 
+                body);
+        };
+
+        REQUIRE(cache.store(
+            make_request(get("/").with_header({ "Accept-Language", "en" })),
+            vary("Hello"),
+            now));
+
+        REQUIRE(cache.store(
+            make_request(get("/").with_header({ "Accept-Language", "fr" })),
+            vary("Bonjour"),
+            now));
+
+        THEN("Each variant should be served to matching requests") {
+            auto en = cache.lookup(
+                make_request(get("/").with_header({ "accept-language", "en" })),
+                now);
+            auto fr = cache.lookup(
+                make_request(get("/").with_header({ "Accept-Language", "fr" })),
+                now);
+            auto de = cache.lookup(
+                make_request(get("/").with_header({ "Accept-Language", "de" })),
+                now);
+
+            REQUIRE(en.status == http::CacheStatus::Hit);
+            REQUIRE(en.bytes->find("Hello") != std::string::npos);
+            REQUIRE(fr.status == http::CacheStatus::Hit);
+            REQUIRE(fr.bytes->find("Bonjour") != std::string::npos);
+            REQUIRE(de.status == http::CacheStatus::Miss);
+        }
+    }
+
+    GIVEN("A cache with a small byte budget") {
+
+        auto options = http::ResponseCacheOptions { };
+        options.max_bytes = 4096;
+        options.shards = 1;
+
+        http::ResponseCache cache { options };
+        auto body = std::string(1024, 'x');
+        auto response = ok({ 
+                std::make_pair("Cache-Control", "max-age=60") 
+            }, 
+            body);
+
+        for (auto i = 0; i < 8; ++i) {
+            cache.store(make_request(get("/" + std::to_string(i))), 
+                        response, 
+                        now);
+        }
+
+        THEN("The least recently used entries should be evicted") {
+            REQUIRE(cache.size_bytes() <= options.max_bytes);
+
+            REQUIRE(cache.lookup(make_request(get("/0")), now).status
+                == http::CacheStatus::Miss);
+            REQUIRE(cache.lookup(make_request(get("/7")), now).status
+                == http::CacheStatus::Hit);
+        }
+    }
+
+    GIVEN("A cached response that was sent with a Date") {
+
+        http::ResponseCache cache { };
+        auto response = ok({
+                std::make_pair("Date", "Sun, 06 Nov 1994 08:49:37 GMT"),
+                std::make_pair("Cache-Control", "max-age=60"),
+                std::make_pair("ETag", "\"v1\""),
+                std::make_pair("Content-Length", "5")
+            }, 
+            "Hello");
+
+        REQUIRE(cache.store(make_request(get("/index")), response, now));
+
+        WHEN("It is served some time later") {
+
+            // The second may change during the lookup...
+            auto before = std::string { "Date: " } + http::current_date();
+            auto lookup = cache.lookup(make_request(get("/index")), 
+                                       now + std::chrono::seconds { 42 });
+            auto after = std::string { "Date: " } + http::current_date();
+
+            THEN("It should have a current Date, and an Age") {
+                REQUIRE(lookup.status == http::CacheStatus::Hit);
+                REQUIRE(lookup.bytes->find("1994") == std::string::npos);
+                REQUIRE((lookup.bytes->find(before) != std::string::npos ||
+                         lookup.bytes->find(after) != std::string::npos));
+                REQUIRE(lookup.bytes->find("Age: 42\r\n") 
+                    != std::string::npos);
+                REQUIRE(lookup.bytes->substr(lookup.bytes->size() - 5) 
+                    == "Hello");
+            }
+
+            AND_WHEN("It is served again, later still") {
+
+                auto later = cache.lookup(make_request(get("/index")), 
+                                          now + std::chrono::seconds { 50 });
+
+                THEN("Its Age should have been updated") {
+                    REQUIRE(later.bytes->find("Age: 50\r\n") 
+                        != std::string::npos);
+                    REQUIRE(lookup.bytes->find("Age: 42\r\n") 
+                        != std::string::npos);
+                }
+            }
+        }
+
+        WHEN("A conditional request for it is made") {
+
+            auto lookup = cache.lookup(
+                make_request(
+                    get("/index").with_header({ "If-None-Match", "\"v1\"" })),
+                now + std::chrono::seconds { 7 });
+
+            THEN("The 304 response should have a current Date, and an Age") {
+                REQUIRE(lookup.status == http::CacheStatus::NotModified);
+                REQUIRE(lookup.bytes->find("1994") == std::string::npos);
+                REQUIRE(lookup.bytes->find("Age: 7\r\n") 
+                    != std::string::npos);
+            }
+        }
+    }
+
+    GIVEN("Responses that arrived with an Age") {
+
+        http::ResponseCache cache { };
+        auto aged = [](char const* age) {
+            return ok({
+                    std::make_pair("Cache-Control", "max-age=60"),
+                    std::make_pair("Age", age),
+                    std::make_pair("Content-Length", "5")
+                }, 
+                "Hello");
+        };
+
+        REQUIRE(cache.store(make_request(get("/aged")), aged("50"), now));
+
+        THEN("The Age should count against their freshness") {
+            auto lookup = cache.lookup(make_request(get("/aged")), 
+                                       now + std::chrono::seconds { 5 });
+            REQUIRE(lookup.status == http::CacheStatus::Hit);
+            REQUIRE(lookup.bytes->find("Age: 55\r\n") != std::string::npos);
+            REQUIRE(lookup.bytes->find("Age: 50") == std::string::npos);
+
+            lookup = cache.lookup(make_request(get("/aged")), 
+                                  now + std::chrono::seconds { 10 });
+            REQUIRE(lookup.status == http::CacheStatus::Miss);
+        }
+
+        THEN("One with no freshness left should not be stored") {
+            REQUIRE(!cache.store(make_request(get("/stale")), 
+                                 aged("60"), 
+                                 now));
+            REQUIRE(!cache.store(make_request(get("/stale")), 
+                                 aged("90"), 
+                                 now));
+        }
+    }
+
+    GIVEN("A response that was received chunked") {
+
+        auto wire = std::string { 
+            "HTTP/1.1 200 OK\r\n"
+            "Cache-Control: max-age=60\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "\r\n"
+            "5\r\nHello\r\n"
+            "0\r\n\r\n"
+        };
+
+        auto parsed = http::parse_response(wire.begin(), wire.end());
+        REQUIRE(parsed.is_ok());
+        auto response = std::get<0>(result::value(std::move(parsed)));
+
+        http::ResponseCache cache { };
+        REQUIRE(cache.store(make_request(get("/chunked")), response, now));
+
+        WHEN("It is served from the cache") {
+
+            auto lookup = cache.lookup(make_request(get("/chunked")), now);
+
+            THEN("It should be sent with a Content-Length instead") {
+                REQUIRE(lookup.status == http::CacheStatus::Hit);
+                REQUIRE(lookup.bytes->find("Transfer-Encoding") 
+                    == std::string::npos);
+                REQUIRE(lookup.bytes->find("Content-Length: 5\r\n") 
+                    != std::string::npos);
+                REQUIRE(lookup.bytes->substr(lookup.bytes->size() - 9) 
+                    == "\r\n\r\nHello");
+            }
+        }
+    }
+
+    GIVEN("A response with a transfer-coding other than chunked") {
+
+        http::ResponseCache cache { };
+        auto response = ok({
+                std::make_pair("Cache-Control", "max-age=60"),
+                std::make_pair("Transfer-Encoding", "gzip, chunked")
+            }, 
+            "not really gzip");
+
+        THEN("It should not be stored") {
+            REQUIRE(!cache.store(make_request(get("/gz")), response, now));
+        }
+    }
+}
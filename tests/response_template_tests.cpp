@@ -0,0 +1,90 @@
+#include "http/response_template.hpp"
+#include "catch.hpp"
+#include <string>
+#include <vector>
+
+SCENARIO("Response templates", "[response_template]") {
+
+    constexpr char DATE[] = "Sun, 06 Nov 1994 08:49:37 GMT";
+
+    GIVEN("A template built from a response head") {
+
+        auto tmpl = http::ResponseTemplate {
+            http::HttpResponseBuilder { }
+                .with_protocol({ 
+                    http::Version::Http11,
+                    static_cast<size_t>(200),
+                    "OK"
+                })
+                .with_headers({
+                    std::make_pair("Server", "MyTestServer"),
+                    std::make_pair("Content-Length", "100"),
+                    std::make_pair("Content-Type", "text/plain")
+                })
+        };
+
+        auto const body = std::string { "Hello, World!" };
+        auto const expected = std::string { 
+            "HTTP/1.1 200 OK\r\n"
+            "Server: MyTestServer\r\n"
+            "Content-Type: text/plain\r\n"
+            "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+            "Content-Length: 13\r\n"
+            "\r\n"
+        };
+
+        WHEN("The head is rendered") {
+
+            auto buffer = std::vector<char>(tmpl.max_head_size());
+            auto len = tmpl.render_head(buffer.data(), body.size(), DATE);
+
+            THEN("The variable fields should be filled in") {
+                REQUIRE(std::string { buffer.data(), len } == expected);
+            }
+        }
+
+        WHEN("The response is gathered") {
+
+            auto fields = http::ResponseTemplate::Fields { };
+            auto buffers = tmpl.gather(fields, 
+                                       DATE, 
+                                       body.data(), 
+                                       body.size());
+
+            THEN("The buffers should form the complete response") {
+                auto wire = std::string { };
+                for (auto const& b : buffers) {
+                    wire.append(static_cast<char const*>(b.data), b.size);
+                }
+
+                REQUIRE(wire == expected + body);
+                REQUIRE(http::buffer_size(buffers.begin(), buffers.end()) 
+                    == wire.size());
+                REQUIRE(buffers.back().data == body.data());
+            }
+        }
+    }
+
+    GIVEN("A template without a Date slot") {
+
+        auto tmpl = http::ResponseTemplate {
+            http::HttpResponseBuilder { }
+                .with_protocol({ 
+                    http::Version::Http11,
+                    static_cast<size_t>(404),
+                    "Not Found"
+                }),
+            false
+        };
+
+        THEN("Only the Content-Length should be written") {
+            auto buffer = std::vector<char>(tmpl.max_head_size());
+            auto len = tmpl.render_head(buffer.data(), 0, nullptr);
+
+            REQUIRE(std::string { buffer.data(), len } ==
+                "HTTP/1.1 404 Not Found\r\n"
+                "Content-Length: 0\r\n"
+                "\r\n");
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#include "http/response_writer.hpp"
+#include "catch.hpp"
+#include <sstream>
+#include <string>
+
+SCENARIO("Chunk size formatting", "[response_writer]") {
+
+    GIVEN("A chunk size") {
+
+        char buffer[http::detail::CHUNK_SIZE_LINE_MAX];
+
+        THEN("It should be formatted as hex followed by CRLF") {
+            auto* first = http::detail::format_chunk_size(0x1f, buffer);
+            REQUIRE(std::string { first, std::end(buffer) } == "1f\r\n");
+
+            first = http::detail::format_chunk_size(0, buffer);
+            REQUIRE(std::string { first, std::end(buffer) } == "0\r\n");
+
+            first = http::detail::format_chunk_size(
+                std::numeric_limits<size_t>::max(), buffer);
+            REQUIRE(first == std::begin(buffer));
+        }
+    }
+}
+
+SCENARIO("Streaming responses", "[response_writer]") {
+
+    GIVEN("A response head") {
+
+        auto head = http::HttpResponseBuilder { }
+            .with_protocol({ 
+                http::Version::Http11,
+                static_cast<size_t>(200),
+                "OK"
+            })
+            .with_headers({
+                std::make_pair("Server", "MyTestServer"),
+                std::make_pair("Content-Length", "100"),
+                std::make_pair("Content-Type", "text/plain")
+            })
+            .build();
+
+        WHEN("The body is written in chunks") {
+
+            auto os = std::ostringstream { };
+            auto writer = http::make_response_writer(os, head);
+
+            auto const head_bytes = os.str();
+
+            std::string const first_part = "Hello";
+            std::string const second_part = ", World!";
+
+            writer.write(first_part.begin(), first_part.end())
+                  .write(second_part.begin(), second_part.end())
+                  .finish({ std::make_pair("X-Checksum", "abc") });
+
+            auto wire = os.str();
+
+            THEN("The headers should be written immediately") {
+                REQUIRE(head_bytes.size() > 0);
+                REQUIRE(head_bytes.find("Transfer-Encoding: chunked\r\n\r\n")
+                    != std::string::npos);
+                REQUIRE(head_bytes.find("Content-Length") 
+                    == std::string::npos);
+            }
+
+            AND_THEN("It should result in a valid chunked response") {
+                REQUIRE(writer.is_finished());
+
+                auto result = http::parse_response(wire.begin(), wire.end());
+
+                REQUIRE_NOTHROW([&] {
+                    if (!result) {
+                        throw std::system_error { result::error(result) };
+                    }
+                }());
+
+                auto resp = std::get<0>(result::value(result));
+                REQUIRE(std::string { resp.body().begin(), resp.body().end() }
+                    == "Hello, World!");
+                REQUIRE(std::get<1>(result::value(result)) == wire.size());
+            }
+        }
+    }
+}
@@ -0,0 +1,240 @@
+#include "http/router.hpp"
+#include "catch.hpp"
+#include <string>
+#include <tuple>
+
+namespace {
+    template<typename T>
+    auto add_route(http::RouterBuilder<T>& builder,
+                   http::Method method,
+                   char const* pattern,
+                   T value) -> std::error_code
+    {
+        auto r = builder.with_route(method, pattern, std::move(value));
+        return r ? std::error_code { } : result::error(std::move(r));
+    }
+}
+
+SCENARIO("Routing requests", "[router]") {
+
+    GIVEN("A router with static, parameter and wildcard routes") {
+
+        auto builder = http::RouterBuilder<std::string> { };
+        for (auto const& route : {
+                std::make_tuple(http::Method::Get, "/", "root"),
+                std::make_tuple(http::Method::Get, "/users", "users"),
+                std::make_tuple(http::Method::Get, "/users/me", "me"),
+                std::make_tuple(http::Method::Get, "/users/:id", "user"),
+                std::make_tuple(http::Method::Get, 
+                                "/users/:id/posts/:post", 
+                                "post"),
+                std::make_tuple(http::Method::Post, "/users", "create-user"),
+                std::make_tuple(http::Method::Get, "/static/*path", "static"),
+                std::make_tuple(http::Method::Get, "/status", "status") })
+        {
+            REQUIRE(builder.with_route(std::get<0>(route),
+                                       std::get<1>(route),
+                                       std::get<2>(route)).is_ok());
+        }
+
+        auto router = std::move(builder).build();
+
+        auto params = http::RouteParameters { };
+
+        THEN("It should contain every route") {
+            REQUIRE(router.size() == 8);
+        }
+
+        WHEN("Static paths are matched") {
+
+            THEN("The exact route should be found") {
+                auto const* r = router.match(http::Method::Get, "/", params);
+                REQUIRE(r);
+                REQUIRE(*r == "root");
+
+                r = router.match(http::Method::Get, "/users", params);
+                REQUIRE(r);
+                REQUIRE(*r == "users");
+                REQUIRE(params.size() == 0);
+
+                r = router.match(http::Method::Get, "/status", params);
+                REQUIRE(r);
+                REQUIRE(*r == "status");
+            }
+
+            AND_THEN("Static segments should take precedence over parameters") {
+                auto const* r = router.match(http::Method::Get, 
+                                             "/users/me", 
+                                             params);
+                REQUIRE(r);
+                REQUIRE(*r == "me");
+                REQUIRE(params.size() == 0);
+            }
+
+            AND_THEN("Routes should be partitioned by method") {
+                auto const* r = router.match(http::Method::Post, 
+                                             "/users", 
+                                             params);
+                REQUIRE(r);
+                REQUIRE(*r == "create-user");
+                REQUIRE(!router.match(http::Method::Delete, "/users", params));
+                REQUIRE(!router.match(http::Method::Post, "/users/1", params));
+            }
+        }
+
+        WHEN("A path with parameters is matched") {
+
+            std::string const path = "/users/42/posts/hello";
+            auto const* r = router.match(http::Method::Get, path, params);
+
+            THEN("The parameters should be views into the path") {
+                REQUIRE(r);
+                REQUIRE(*r == "post");
+                REQUIRE(params.size() == 2);
+                REQUIRE(params[0].name == "id");
+                REQUIRE(params[0].value == "42");
+                REQUIRE(params[0].value.data() == path.data() + 7);
+                REQUIRE(params[1].name == "post");
+                REQUIRE(params[1].value == "hello");
+
+                auto value = http::StringView { };
+                REQUIRE(params.find("post", value));
+                REQUIRE(value == "hello");
+                REQUIRE(!params.find("missing", value));
+            }
+        }
+
+        WHEN("A parameter would need to span segments") {
+
+            THEN("A shorter route should not match") {
+                REQUIRE(!router.match(http::Method::Get, 
+                                      "/users/42/posts", 
+                                      params));
+                REQUIRE(!router.match(http::Method::Get, "/users/", params));
+            }
+        }
+
+        WHEN("A path under a wildcard is matched") {
+
+            auto const* r = router.match(http::Method::Get, 
+                                         "/static/css/site.css", 
+                                         params);
+
+            THEN("The wildcard should capture the rest of the path") {
+                REQUIRE(r);
+                REQUIRE(*r == "static");
+                REQUIRE(params.size() == 1);
+                REQUIRE(params[0].name == "path");
+                REQUIRE(params[0].value == "css/site.css");
+            }
+
+            AND_THEN("The wildcard may capture nothing") {
+                r = router.match(http::Method::Get, "/static/", params);
+                REQUIRE(r);
+                REQUIRE(params[0].value.empty());
+            }
+        }
+
+        WHEN("A path partially matches a static route") {
+
+            THEN("It should not match") {
+                REQUIRE(!router.match(http::Method::Get, "/stat", params));
+                REQUIRE(!router.match(http::Method::Get, "/statuses", params));
+                REQUIRE(!router.match(http::Method::Get, "/usersx", params));
+            }
+        }
+    }
+
+    GIVEN("Routes that require backtracking") {
+
+        auto builder = http::RouterBuilder<int> { };
+        REQUIRE(builder.with_route(http::Method::Get, "/a/b/c", 1).is_ok());
+        REQUIRE(builder.with_route(http::Method::Get, "/a/:x/d", 2).is_ok());
+        REQUIRE(builder.with_route(http::Method::Get, "/a/*rest", 3).is_ok());
+
+        auto router = std::move(builder).build();
+
+        auto params = http::RouteParameters { };
+
+        THEN("A failed static branch should fall back to a parameter") {
+            auto const* r = router.match(http::Method::Get, "/a/b/d", params);
+            REQUIRE(r);
+            REQUIRE(*r == 2);
+            REQUIRE(params.size() == 1);
+            REQUIRE(params[0].value == "b");
+        }
+
+        AND_THEN("A failed parameter branch should fall back to a wildcard") {
+            auto const* r = router.match(http::Method::Get, "/a/b/e", params);
+            REQUIRE(r);
+            REQUIRE(*r == 3);
+            REQUIRE(params.size() == 1);
+            REQUIRE(params[0].name == "rest");
+            REQUIRE(params[0].value == "b/e");
+        }
+    }
+
+    GIVEN("Invalid route patterns") {
+
+        auto builder = http::RouterBuilder<int> { };
+
+        THEN("Adding them should fail with a router error") {
+            REQUIRE(add_route(builder, http::Method::Get, "users", 1) ==
+                make_error_code(http::RouteError::MISSING_LEADING_SLASH));
+
+            REQUIRE(add_route(builder, http::Method::Get, "/users/:", 1) ==
+                make_error_code(http::RouteError::UNNAMED_PARAMETER));
+
+            REQUIRE(add_route(builder, 
+                              http::Method::Get, 
+                              "/files/*path/x", 
+                              1) ==
+                make_error_code(http::RouteError::MISPLACED_WILDCARD));
+
+            REQUIRE(!add_route(builder, http::Method::Get, "/users/:id", 1));
+            REQUIRE(add_route(builder, http::Method::Get, "/users/:name", 2)
+                == make_error_code(http::RouteError::DUPLICATE_ROUTE));
+
+            REQUIRE(std::move(builder).build().size() == 1);
+        }
+    }
+
+    GIVEN("A router where a pattern with too many parameters was rejected") {
+        auto pattern = std::string { };
+        auto path = std::string { };
+        for (size_t i = 0; i <= http::MAX_ROUTE_PARAMETERS; ++i) {
+            pattern += "/:p" + std::to_string(i);
+            path += "/" + std::to_string(i);
+        }
+
+        auto builder = http::RouterBuilder<int> { };
+        REQUIRE(!add_route(builder, http::Method::Get, "/users/:id", 1));
+        REQUIRE(add_route(builder, http::Method::Get, pattern.c_str(), 2) ==
+            make_error_code(http::RouteError::TOO_MANY_PARAMETERS));
+
+        auto router = std::move(builder).build();
+
+        WHEN("A path with as many segments is matched") {
+            auto params = http::RouteParameters { };
+            auto const* route = router.match(http::Method::Get, path, params);
+
+            THEN("It shouldn't match anything") {
+                REQUIRE(route == nullptr);
+            }
+        }
+
+        WHEN("The remaining route is matched") {
+            auto params = http::RouteParameters { };
+            auto const* route = router.match(http::Method::Get, 
+                                             "/users/42", 
+                                             params);
+
+            THEN("It should still match") {
+                REQUIRE(route != nullptr);
+                REQUIRE(*route == 1);
+                REQUIRE(params.size() == 1);
+                REQUIRE(params[0].value == "42");
+            }
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#include "http/http.hpp"
+#include "http/url.hpp"
+#include "catch.hpp"
+#include <string>
+#include <vector>
+
+SCENARIO("Request-target decomposition", "[url]") {
+
+    GIVEN("A request with a query string and fragment") {
+
+        auto request = http::HttpRequestBuilder { }
+            .with_protocol({ 
+                http::Method::Get, 
+                "/search/items?q=hello%20world&&page=2&flag#results",
+                http::Version::Http11 
+            })
+            .build();
+
+        WHEN("Its target is parsed") {
+
+            auto result = request.target();
+            REQUIRE(result.is_ok());
+            auto target = result::value(std::move(result));
+
+            THEN("Each component should be a view into the path") {
+                REQUIRE(target.path == "/search/items");
+                REQUIRE(target.query == "q=hello%20world&&page=2&flag");
+                REQUIRE(target.fragment == "results");
+                REQUIRE(target.host.empty());
+                REQUIRE(target.path.data() == request.path().data());
+            }
+
+            AND_THEN("The query parameters should be iterable") {
+                auto params = std::vector<std::pair<std::string, std::string>> { };
+                for (auto const& p : target.query_parameters()) {
+                    params.emplace_back(p.name.to_string(), 
+                                        p.value.to_string());
+                }
+
+                REQUIRE(params.size() == 3);
+                REQUIRE(params[0].first == "q");
+                REQUIRE(params[0].second == "hello%20world");
+                REQUIRE(params[1].first == "page");
+                REQUIRE(params[1].second == "2");
+                REQUIRE(params[2].first == "flag");
+                REQUIRE(params[2].second.empty());
+            }
+
+            AND_THEN("A parameter can be found by name") {
+                auto value = http::StringView { };
+                REQUIRE(target.find_query_parameter("page", value));
+                REQUIRE(value == "2");
+                REQUIRE(!target.find_query_parameter("missing", value));
+            }
+        }
+    }
+
+    GIVEN("An absolute-form target") {
+
+        auto result = http::parse_target("http://example.com:8080/index?a=1");
+
+        THEN("The authority should be available") {
+            REQUIRE(result.is_ok());
+            auto target = result::value(std::move(result));
+            REQUIRE(target.schema == "http");
+            REQUIRE(target.host == "example.com");
+            REQUIRE(target.port == 8080);
+            REQUIRE(target.path == "/index");
+            REQUIRE(target.query == "a=1");
+        }
+    }
+
+    GIVEN("An invalid target") {
+
+        auto result = http::parse_target("/has space");
+
+        THEN("It should fail") {
+            REQUIRE(!result.is_ok());
+            REQUIRE(result::error(result) 
+                == make_error_code(http::ParseError::INVALID_URL));
+        }
+    }
+}
+
+SCENARIO("Percent-decoding", "[url]") {
+
+    GIVEN("Encoded text") {
+
+        auto encoded = std::string { "hello%20world%2Fagain+more" };
+
+        THEN("It should be decoded into a caller-provided buffer") {
+            char buffer[64];
+            auto r = http::percent_decode(encoded, buffer, sizeof(buffer));
+            REQUIRE(r.is_ok());
+            REQUIRE(std::string { buffer, result::value(r) } 
+                == "hello world/again+more");
+        }
+
+        AND_THEN("It should be decodable in place") {
+            auto r = http::percent_decode(encoded, 
+                                          &encoded[0], 
+                                          encoded.size(),
+                                          true);
+            REQUIRE(r.is_ok());
+            encoded.resize(result::value(r));
+            REQUIRE(encoded == "hello world/again more");
+        }
+
+        AND_THEN("Malformed escapes should be rejected") {
+            char buffer[64];
+            REQUIRE(!http::percent_decode("50%", buffer, sizeof(buffer)));
+            REQUIRE(!http::percent_decode("%zz", buffer, sizeof(buffer)));
+            REQUIRE(!http::percent_decode("abc", buffer, 2));
+        }
+    }
+}
@@ -0,0 +1,244 @@
+#include "http/http.hpp"
+#include "http/websocket.hpp"
+#include "catch.hpp"
+#include <sstream>
+#include <string>
+#include <vector>
+
+SCENARIO("WebSocket handshakes", "[websocket]") {
+
+    GIVEN("The opening handshake from RFC 6455") {
+        std::string const HTTP_REQUEST = 
+            "GET /chat HTTP/1.1\r\n"
+            "Host: server.example.com\r\n"
+            "Upgrade: websocket\r\n"
+            "Connection: keep-alive, Upgrade\r\n"
+            "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+            "Sec-WebSocket-Version: 13\r\n"
+            "\r\n"
+            "\x81\x05Hello";
+
+        auto result = http::parse_request(HTTP_REQUEST.begin(), 
+                                          HTTP_REQUEST.end());
+        REQUIRE(result.is_ok());
+        auto parsed = result::value(std::move(result));
+        auto const& request = std::get<0>(parsed);
+
+        THEN("The request should be marked as an upgrade") {
+            REQUIRE(request.is_upgrade());
+            REQUIRE(http::is_websocket_handshake(request));
+            REQUIRE(std::get<1>(parsed) == HTTP_REQUEST.size() - 7);
+        }
+
+        WHEN("The handshake response is built") {
+
+            auto response = http::make_websocket_handshake(request);
+
+            THEN("It should accept the key") {
+                REQUIRE(response.is_ok());
+                auto r = result::value(std::move(response));
+                REQUIRE(r.status_code() == 101);
+                REQUIRE(r.is_upgrade());
+                REQUIRE(std::get<1>(*http::find_header(r.headers(), 
+                                                       "Sec-WebSocket-Accept")) 
+                    == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+            }
+        }
+
+        WHEN("The handshake response is rendered") {
+
+            char out[http::WEBSOCKET_HANDSHAKE_SIZE];
+            auto n = http::render_websocket_handshake(
+                "dGhlIHNhbXBsZSBub25jZQ==", 
+                out);
+
+            THEN("It should be a complete response") {
+                REQUIRE(n == sizeof(out));
+                REQUIRE(std::string { out, n } ==
+                    "HTTP/1.1 101 Switching Protocols\r\n"
+                    "Upgrade: websocket\r\n"
+                    "Connection: Upgrade\r\n"
+                    "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"
+                    "\r\n");
+            }
+        }
+    }
+
+    GIVEN("Requests that aren't valid handshakes") {
+
+        auto make = [](char const* version, char const* key) {
+            return http::HttpRequestBuilder { }
+                .with_protocol({ 
+                    http::Method::Get, 
+                    "/chat", 
+                    http::Version::Http11 
+                })
+                .with_headers({
+                    std::make_pair("Upgrade", "websocket"),
+                    std::make_pair("Connection", "Upgrade"),
+                    std::make_pair("Sec-WebSocket-Key", key),
+                    std::make_pair("Sec-WebSocket-Version", version)
+                })
+                .build();
+        };
+
+        THEN("The handshake should be refused") {
+            auto plain = http::HttpRequestBuilder { }
+                .with_protocol({ http::Method::Get, "/", http::Version::Http11 })
+                .build();
+            REQUIRE(!http::is_websocket_handshake(plain));
+            REQUIRE(result::error(http::make_websocket_handshake(plain)) ==
+                make_error_code(http::WebSocketError::NOT_A_HANDSHAKE));
+
+            auto old = make("8", "dGhlIHNhbXBsZSBub25jZQ==");
+            REQUIRE(!http::is_websocket_handshake(old));
+            REQUIRE(result::error(http::make_websocket_handshake(old)) ==
+                make_error_code(http::WebSocketError::UNSUPPORTED_VERSION));
+
+            auto bad_key = make("13", "not a key");
+            REQUIRE(!http::is_websocket_handshake(bad_key));
+            REQUIRE(result::error(http::make_websocket_handshake(bad_key)) ==
+                make_error_code(http::WebSocketError::INVALID_KEY));
+        }
+    }
+}
+
+SCENARIO("WebSocket frames", "[websocket]") {
+
+    GIVEN("The masked text frame from RFC 6455") {
+        std::vector<uint8_t> bytes = { 
+            0x81, 0x85, 0x37, 0xfa, 0x21, 0x3d, 
+            0x7f, 0x9f, 0x4d, 0x51, 0x58 
+        };
+
+        WHEN("It is parsed") {
+
+            auto frame = http::WebSocketFrame { };
+            auto r = http::parse_frame(bytes.data(), bytes.size(), frame);
+
+            THEN("The payload should be unmasked in place") {
+                REQUIRE(r.is_ok());
+                REQUIRE(result::value(std::move(r)) == bytes.size());
+                REQUIRE(frame.fin);
+                REQUIRE(frame.opcode == http::Opcode::Text);
+                REQUIRE(frame.masked);
+                REQUIRE(frame.payload == bytes.data() + 6);
+                REQUIRE(std::string { 
+                            frame.payload, 
+                            frame.payload + frame.payload_size 
+                        } == "Hello");
+            }
+        }
+
+        WHEN("Only part of it has arrived") {
+
+            auto frame = http::WebSocketFrame { };
+
+            THEN("More data should be requested") {
+                for (size_t n = 0; n < bytes.size(); ++n) {
+                    auto r = http::parse_frame(bytes.data(), n, frame);
+                    REQUIRE(r.is_ok());
+                    REQUIRE(result::value(std::move(r)) == 0);
+                }
+            }
+        }
+
+        WHEN("It is parsed by a client") {
+
+            auto options = http::FrameParseOptions { };
+            options.require_mask = false;
+
+            bytes[1] &= 0x7f;
+            bytes.erase(bytes.begin() + 2, bytes.begin() + 6);
+
+            auto frame = http::WebSocketFrame { };
+            auto r = http::parse_frame(bytes.data(), 
+                                       bytes.size(), 
+                                       frame, 
+                                       options);
+
+            THEN("Unmasked frames should be accepted") {
+                REQUIRE(r.is_ok());
+                REQUIRE(!frame.masked);
+                REQUIRE(frame.payload_size == 5);
+            }
+        }
+    }
+
+    GIVEN("Invalid frames") {
+
+        auto error_of = [](std::vector<uint8_t> bytes) {
+            auto frame = http::WebSocketFrame { };
+            auto r = http::parse_frame(bytes.data(), bytes.size(), frame);
+            REQUIRE(!r);
+            return result::error(std::move(r));
+        };
+
+        THEN("They should be rejected") {
+            REQUIRE(error_of({ 0x81, 0x05 }) == 
+                make_error_code(http::WebSocketError::UNMASKED_FRAME));
+            REQUIRE(error_of({ 0xc1, 0x80 }) == 
+                make_error_code(http::WebSocketError::RESERVED_BITS_SET));
+            REQUIRE(error_of({ 0x83, 0x80 }) == 
+                make_error_code(http::WebSocketError::INVALID_OPCODE));
+            REQUIRE(error_of({ 0x09, 0x80 }) == 
+                make_error_code(http::WebSocketError::FRAGMENTED_CONTROL_FRAME));
+            REQUIRE(error_of({ 0x89, 0xfe, 0x00, 0x7e }) == 
+                make_error_code(http::WebSocketError::CONTROL_FRAME_TOO_LARGE));
+            REQUIRE(error_of({ 0x82, 0xfe, 0x00, 0x05 }) == 
+                make_error_code(http::WebSocketError::NON_MINIMAL_LENGTH));
+        }
+    }
+
+    GIVEN("A large binary payload") {
+
+        auto payload = std::vector<uint8_t>(70000);
+        for (size_t i = 0; i < payload.size(); ++i) {
+            payload[i] = static_cast<uint8_t>(i * 7);
+        }
+
+        WHEN("It is framed, masked, and parsed again") {
+
+            auto const mask = std::array<uint8_t, 4> {{ 1, 2, 3, 4 }};
+
+            auto bytes = std::vector<uint8_t>(http::MAX_FRAME_HEADER_SIZE);
+            auto n = http::write_frame_header(bytes.data(),
+                                              http::Opcode::Binary,
+                                              payload.size(),
+                                              true,
+                                              &mask);
+            bytes.resize(n);
+            bytes.insert(bytes.end(), payload.begin(), payload.end());
+
+            // Mask from an odd offset, to exercise every path...
+            http::apply_mask(bytes.data() + n, 3, mask);
+            http::apply_mask(bytes.data() + n + 3, 
+                             payload.size() - 3, 
+                             mask, 
+                             3);
+
+            auto frame = http::WebSocketFrame { };
+            auto r = http::parse_frame(bytes.data(), bytes.size(), frame);
+
+            THEN("The original payload should be recovered") {
+                REQUIRE(n == 14);
+                REQUIRE(r.is_ok());
+                REQUIRE(frame.opcode == http::Opcode::Binary);
+                REQUIRE(frame.payload_size == payload.size());
+                REQUIRE(std::equal(payload.begin(), 
+                                   payload.end(), 
+                                   frame.payload));
+            }
+        }
+    }
+
+    GIVEN("A message to send") {
+
+        auto os = std::ostringstream { };
+        http::write_frame(os, http::Opcode::Text, "Hello", 5);
+
+        THEN("It should be written as an unmasked frame") {
+            REQUIRE(os.str() == std::string { "\x81\x05Hello" });
+        }
+    }
+}
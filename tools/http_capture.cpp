@@ -0,0 +1,566 @@
+// Records HTTP/1.x traffic to a capture file, and replays captures
+// through the parser and serializers, to measure them against real
+// traffic rather than synthetic messages.
+//
+// Usage:
+//   http_capture record <capture> <listen-port> <upstream-port> [upstream-host]
+//       Proxies connections to 127.0.0.1:<listen-port> through to the
+//       upstream server, recording what is sent each way. Runs until
+//       interrupted; each record is flushed as it is written.
+//
+//   http_capture import <capture> <file>...
+//       Records each file as one connection. A file starting with "HTTP/"
+//       is taken to hold responses; anything else, requests.
+//
+//   http_capture replay <capture> [iterations]
+//       Splits the captured streams into messages, then parses each one
+//       `iterations` times with `parse_request()` or `parse_response()`,
+//       serializing the result with `forward_request()` or
+//       `operator<<`. Reports throughput, latency percentiles and the
+//       number of allocations per message.
+//
+// Replay splits response streams without knowing which requests they
+// answer, so a response to `HEAD` that has a `Content-Length` isn't
+// split correctly. Streams stop being split after a protocol upgrade.
+
+#include "http/http.hpp"
+#include "http/forward.hpp"
+#include "socket.hpp"
+#include <poll.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    // Counts every allocation made through `operator new`, so that replay
+    // can report how many each parse and serialization makes...
+    std::atomic<size_t> allocations { 0 };
+}
+
+auto operator new(std::size_t size) -> void* {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+
+    throw std::bad_alloc { };
+}
+
+auto operator delete(void* p) noexcept -> void {
+    std::free(p);
+}
+
+auto operator delete(void* p, std::size_t) noexcept -> void {
+    std::free(p);
+}
+
+namespace {
+
+    // A capture file is "HTTPCAP1", followed by records of:
+    //
+    //     connection  u32, little-endian
+    //     direction   u8; 0 for client to server, 1 for server to client
+    //     size        u32, little-endian
+    //     bytes       `size` bytes, as read from the connection
+    constexpr char MAGIC[] = "HTTPCAP1";
+    constexpr size_t MAGIC_SIZE = sizeof(MAGIC) - 1;
+    constexpr size_t RECORD_HEADER_SIZE = 9;
+
+    enum class Direction : uint8_t {
+        Request = 0,
+        Response = 1,
+    };
+
+    auto put_u32(char* out, uint32_t n) noexcept -> void {
+        for (auto i = 0; i < 4; ++i) {
+            out[i] = static_cast<char>((n >> (8 * i)) & 0xff);
+        }
+    }
+
+    auto get_u32(char const* in) noexcept -> uint32_t {
+        auto n = uint32_t { 0 };
+        for (auto i = 0; i < 4; ++i) {
+            n |= static_cast<uint32_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+        }
+
+        return n;
+    }
+
+    struct CaptureWriter {
+        explicit CaptureWriter(char const* path) :
+            out_ { path, std::ios::binary | std::ios::trunc }
+        {
+            if (!out_) {
+                throw std::runtime_error {
+                    std::string { "can't open " } + path
+                };
+            }
+
+            out_.write(MAGIC, MAGIC_SIZE);
+            out_.flush();
+        }
+
+        // Safe to call from several connections' threads at once...
+        auto append(uint32_t connection,
+                    Direction direction,
+                    char const* data,
+                    size_t size) -> void
+        {
+            char header[RECORD_HEADER_SIZE];
+            put_u32(header, connection);
+            header[4] = static_cast<char>(direction);
+            put_u32(header + 5, static_cast<uint32_t>(size));
+
+            std::lock_guard<std::mutex> lock { mutex_ };
+            out_.write(header, sizeof(header));
+            out_.write(data, static_cast<std::streamsize>(size));
+            out_.flush();
+        }
+
+    private:
+        std::mutex mutex_;
+        std::ofstream out_;
+    };
+
+    // The bytes sent one way over one connection...
+    struct Stream {
+        uint32_t connection;
+        Direction direction;
+        std::string bytes;
+    };
+
+    auto read_capture(char const* path) -> std::vector<Stream> {
+        auto in = std::ifstream { path, std::ios::binary };
+        if (!in) {
+            throw std::runtime_error { std::string { "can't open " } + path };
+        }
+
+        auto const file = std::string {
+            std::istreambuf_iterator<char> { in },
+            std::istreambuf_iterator<char> { }
+        };
+
+        if (file.compare(0, MAGIC_SIZE, MAGIC) != 0) {
+            throw std::runtime_error {
+                std::string { path } + " isn't a capture file"
+            };
+        }
+
+        auto streams = std::map<std::pair<uint32_t, uint8_t>, std::string> { };
+        auto offset = MAGIC_SIZE;
+        while (file.size() - offset >= RECORD_HEADER_SIZE) {
+            auto const* p = file.data() + offset;
+            auto const size = get_u32(p + 5);
+            if (file.size() - offset - RECORD_HEADER_SIZE < size) {
+                break;
+            }
+
+            auto const key = std::make_pair(get_u32(p),
+                                            static_cast<uint8_t>(p[4]));
+            streams[key].append(p + RECORD_HEADER_SIZE, size);
+            offset += RECORD_HEADER_SIZE + size;
+        }
+
+        if (offset != file.size()) {
+            std::cerr << path << ": ignoring a truncated record\n";
+        }
+
+        auto result = std::vector<Stream> { };
+        for (auto& s : streams) {
+            result.push_back({
+                std::get<0>(s.first),
+                static_cast<Direction>(std::get<1>(s.first)),
+                std::move(s.second)
+            });
+        }
+
+        return result;
+    }
+
+    // Relays one proxied connection until both sides have finished...
+    auto relay(uint32_t id,
+               tools::Socket client,
+               tools::Socket upstream,
+               CaptureWriter& capture) -> void
+    {
+        tools::Socket const* sockets[] = { &client, &upstream };
+        bool open[] = { true, true };
+        char buffer[64 * 1024];
+
+        while (open[0] || open[1]) {
+            pollfd fds[2];
+            for (auto i = 0; i < 2; ++i) {
+                fds[i].fd = open[i] ? sockets[i]->get() : -1;
+                fds[i].events = POLLIN;
+                fds[i].revents = 0;
+            }
+
+            if (::poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                break;
+            }
+
+            for (auto i = 0; i < 2; ++i) {
+                if (!open[i] || !fds[i].revents) {
+                    continue;
+                }
+
+                auto const& to = *sockets[1 - i];
+                auto n = tools::read_some(*sockets[i], buffer, sizeof(buffer));
+                if (!n) {
+                    open[i] = false;
+                    ::shutdown(to.get(), SHUT_WR);
+                    continue;
+                }
+
+                capture.append(id,
+                               i == 0 ? Direction::Request
+                                      : Direction::Response,
+                               buffer,
+                               n);
+
+                if (!tools::write_all(to, buffer, n)) {
+                    return;
+                }
+            }
+        }
+    }
+
+    auto record(char const* path,
+                uint16_t port,
+                uint16_t upstream_port,
+                char const* upstream_host) -> int
+    {
+        CaptureWriter capture { path };
+        auto listener = tools::listen_loopback(port);
+
+        std::cerr << "recording 127.0.0.1:" << tools::local_port(listener)
+                  << " -> " << upstream_host << ":" << upstream_port
+                  << " to " << path << "\n";
+
+        for (uint32_t id = 1; ; ++id) {
+            auto client = tools::accept(listener);
+
+            try {
+                auto upstream = tools::connect(upstream_host, upstream_port);
+                std::thread {
+                    relay,
+                    id,
+                    std::move(client),
+                    std::move(upstream),
+                    std::ref(capture)
+                }.detach();
+            }
+            catch (std::system_error const& e) {
+                std::cerr << "connection " << id << ": " << e.what() << "\n";
+            }
+        }
+    }
+
+    auto import_files(char const* path, char** files, int count) -> int {
+        CaptureWriter capture { path };
+
+        for (auto i = 0; i < count; ++i) {
+            auto in = std::ifstream { files[i], std::ios::binary };
+            if (!in) {
+                std::cerr << "can't open " << files[i] << "\n";
+                return 1;
+            }
+
+            auto const bytes = std::string {
+                std::istreambuf_iterator<char> { in },
+                std::istreambuf_iterator<char> { }
+            };
+
+            auto const direction = bytes.compare(0, 5, "HTTP/") == 0
+                ? Direction::Response
+                : Direction::Request;
+
+            capture.append(static_cast<uint32_t>(i + 1),
+                           direction,
+                           bytes.data(),
+                           bytes.size());
+        }
+
+        return 0;
+    }
+
+    // One message, as a view into its stream...
+    struct Message {
+        char const* data;
+        size_t size;
+    };
+
+    // Splits `stream` into messages, stopping at the first it can't
+    // parse. Returns `false` if that happened before the end...
+    template<typename Parse>
+    auto split(std::string const& stream,
+               std::vector<Message>& messages,
+               Parse&& parse) -> bool
+    {
+        auto offset = size_t { 0 };
+        while (offset < stream.size()) {
+            auto result = parse(stream.data() + offset,
+                                stream.data() + stream.size());
+            if (!result) {
+                return false;
+            }
+
+            auto const parsed = result::value(std::move(result));
+            messages.push_back({ stream.data() + offset,
+                                 std::get<1>(parsed) });
+            offset += std::get<1>(parsed);
+
+            if (std::get<0>(parsed).is_upgrade()) {
+                break;
+            }
+        }
+
+        return true;
+    }
+
+    // Discards what is written to it; for measuring serialization on its
+    // own...
+    struct NullBuffer : std::streambuf {
+    protected:
+        auto overflow(int_type c) -> int_type override {
+            return traits_type::not_eof(c);
+        }
+
+        auto xsputn(char const*, std::streamsize n) -> std::streamsize
+            override
+        {
+            return n;
+        }
+    };
+
+    struct Measurements {
+        std::vector<uint64_t> parse_ns;
+        std::vector<uint64_t> serialize_ns;
+        size_t parse_allocations = 0;
+        size_t serialize_allocations = 0;
+        size_t bytes = 0;
+        size_t failures = 0;
+    };
+
+    auto percentile(std::vector<uint64_t> const& sorted, double p)
+        -> uint64_t
+    {
+        if (sorted.empty()) {
+            return 0;
+        }
+
+        auto n = static_cast<size_t>(p / 100.0 * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(n, sorted.size() - 1)];
+    }
+
+    auto report_latency(char const* name,
+                        std::vector<uint64_t>& ns,
+                        size_t bytes,
+                        size_t allocs) -> void
+    {
+        std::sort(ns.begin(), ns.end());
+
+        auto total = uint64_t { 0 };
+        for (auto n : ns) {
+            total += n;
+        }
+
+        auto const count = std::max(ns.size(), static_cast<size_t>(1));
+        auto const seconds = std::max(total * 1e-9, 1e-9);
+
+        std::cout << "  " << std::left << std::setw(10) << name
+                  << std::fixed << std::setprecision(1)
+                  << (bytes / seconds / 1e6) << " MB/s, "
+                  << (ns.size() / seconds) << " msg/s, "
+                  << static_cast<double>(allocs) / count << " allocs/msg\n"
+                  << "  " << std::setw(10) << ""
+                  << "ns p50 " << percentile(ns, 50)
+                  << "  p90 " << percentile(ns, 90)
+                  << "  p99 " << percentile(ns, 99)
+                  << "  p99.9 " << percentile(ns, 99.9)
+                  << "  max " << (ns.empty() ? 0 : ns.back()) << "\n";
+    }
+
+    template<typename Parse, typename Serialize>
+    auto measure(std::vector<Message> const& messages,
+                 size_t iterations,
+                 Parse&& parse,
+                 Serialize&& serialize) -> Measurements
+    {
+        using Clock = std::chrono::steady_clock;
+
+        auto m = Measurements { };
+        m.parse_ns.reserve(messages.size() * iterations);
+        m.serialize_ns.reserve(messages.size() * iterations);
+
+        auto const ns = [](Clock::duration d) {
+            return static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(d)
+                    .count());
+        };
+
+        for (size_t i = 0; i < iterations; ++i) {
+            for (auto const& message : messages) {
+                auto const a0 = allocations.load(std::memory_order_relaxed);
+                auto const t0 = Clock::now();
+                auto result = parse(message.data, message.data + message.size);
+                auto const t1 = Clock::now();
+                auto const a1 = allocations.load(std::memory_order_relaxed);
+
+                m.parse_ns.push_back(ns(t1 - t0));
+                m.parse_allocations += a1 - a0;
+                m.bytes += message.size;
+
+                if (!result) {
+                    ++m.failures;
+                    continue;
+                }
+
+                auto const parsed = result::value(std::move(result));
+
+                auto const a2 = allocations.load(std::memory_order_relaxed);
+                auto const t2 = Clock::now();
+                serialize(message, std::get<0>(parsed));
+                auto const t3 = Clock::now();
+                auto const a3 = allocations.load(std::memory_order_relaxed);
+
+                m.serialize_ns.push_back(ns(t3 - t2));
+                m.serialize_allocations += a3 - a2;
+            }
+        }
+
+        return m;
+    }
+
+    auto report(char const* name, Measurements& m) -> void {
+        std::cout << name << ": " << m.parse_ns.size() << " messages, "
+                  << m.failures << " failed\n";
+        report_latency("parse", m.parse_ns, m.bytes, m.parse_allocations);
+        report_latency("serialize",
+                       m.serialize_ns,
+                       m.bytes,
+                       m.serialize_allocations);
+    }
+
+    auto replay(char const* path, size_t iterations) -> int {
+        auto const parse_request = [](char const* first, char const* last) {
+            return http::parse_request(first, last);
+        };
+
+        auto const parse_response = [](char const* first, char const* last) {
+            return http::parse_response(first, last);
+        };
+
+        auto const streams = read_capture(path);
+
+        auto requests = std::vector<Message> { };
+        auto responses = std::vector<Message> { };
+        for (auto const& s : streams) {
+            auto const complete = s.direction == Direction::Request
+                ? split(s.bytes, requests, parse_request)
+                : split(s.bytes, responses, parse_response);
+
+            if (!complete) {
+                std::cerr << "connection " << s.connection << ": "
+                          << (s.direction == Direction::Request
+                                ? "requests" : "responses")
+                          << " stop at an unparseable message\n";
+            }
+        }
+
+        std::cout << streams.size() << " streams, "
+                  << requests.size() << " requests, "
+                  << responses.size() << " responses, "
+                  << iterations << " iterations\n";
+
+        NullBuffer null_buffer;
+        std::ostream sink { &null_buffer };
+
+        auto request_measurements = measure(
+            requests,
+            iterations,
+            parse_request,
+            [](Message const& m, http::HttpRequest const& request) {
+                auto forwarded = http::forward_request(m.data, m.size, request);
+                (void)forwarded;
+            });
+
+        auto response_measurements = measure(
+            responses,
+            iterations,
+            parse_response,
+            [&](Message const&, http::HttpResponse const& response) {
+                sink << response;
+            });
+
+        report("requests", request_measurements);
+        report("responses", response_measurements);
+        return 0;
+    }
+
+    auto usage() -> int {
+        std::cerr
+            << "usage: http_capture record <capture> <listen-port> "
+               "<upstream-port> [upstream-host]\n"
+            << "       http_capture import <capture> <file>...\n"
+            << "       http_capture replay <capture> [iterations]\n";
+        return 2;
+    }
+
+    auto port(char const* s) -> uint16_t {
+        return static_cast<uint16_t>(std::strtoul(s, nullptr, 10));
+    }
+}
+
+auto main(int argc, char** argv) -> int {
+    if (argc < 3) {
+        return usage();
+    }
+
+    auto const command = std::string { argv[1] };
+
+    try {
+        if (command == "record" && argc >= 5) {
+            tools::ignore_sigpipe();
+            return record(argv[2],
+                          port(argv[3]),
+                          port(argv[4]),
+                          argc > 5 ? argv[5] : "127.0.0.1");
+        }
+
+        if (command == "import" && argc >= 4) {
+            return import_files(argv[2], argv + 3, argc - 3);
+        }
+
+        if (command == "replay") {
+            auto const iterations = argc > 3
+                ? static_cast<size_t>(std::strtoull(argv[3], nullptr, 10))
+                : static_cast<size_t>(100);
+            return replay(argv[2], iterations);
+        }
+    }
+    catch (std::exception const& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    return usage();
+}
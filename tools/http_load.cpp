@@ -0,0 +1,610 @@
+// Generates HTTP/1.1 load using the library itself: requests are built
+// with `HttpRequestBuilder` and serialized with `operator<<`, and
+// responses are parsed with `parse_response()`.
+//
+// Usage: http_load [options] [port]
+//   --connections <n>  keep-alive connections to use (default 16)
+//   --threads <n>      threads to spread the connections over (default:
+//                      one per core, but no more than the connections)
+//   --depth <n>        requests in flight per connection, i.e. the
+//                      pipelining depth (default 1)
+//   --duration <s>     seconds to run for (default 10)
+//   --rate <r>         open loop: send `r` requests per second in total,
+//                      on a fixed schedule. Without it, the load is
+//                      closed-loop: each response is followed by the
+//                      next request straight away
+//   --path <path>      the request-target (default "/")
+//   --body <bytes>     send POSTs with a body of this size, not GETs
+//   --host <address>   the server's IPv4 address (default 127.0.0.1)
+//
+// Without a port, a built-in server is started on a free loopback port.
+// It parses each request with `parse_request<Capture::None>()` and
+// returns a fixed response. It shares the machine with the load, so it
+// is for exercising the client and the library, rather than for
+// measuring a server.
+//
+// In open-loop mode, latency is measured from when each request was
+// scheduled to be sent, not from when it actually was. A server that
+// stalls is charged for every request it held up, instead of the stall
+// hiding them (which is known as "coordinated omission").
+
+#include "http/http.hpp"
+#include "socket.hpp"
+#include <poll.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    using Clock = std::chrono::steady_clock;
+
+    // A latency histogram in the style of HdrHistogram. Values are kept
+    // to a fixed relative precision (about 1%), from 1ns up to a day and
+    // a half, in a fixed set of counters. Recording is cheap and
+    // allocation-free, and the histograms of several threads can simply
+    // be added together...
+    struct Histogram {
+        // Each power-of-two range is split into this many counters...
+        static constexpr unsigned SUB_BUCKET_BITS = 7;
+        static constexpr uint64_t SUB_BUCKETS = uint64_t { 1 } << SUB_BUCKET_BITS;
+        static constexpr uint64_t HALF = SUB_BUCKETS / 2;
+        static constexpr unsigned MAX_EXPONENT = 40;
+
+        Histogram() :
+            counts_(HALF * (MAX_EXPONENT + 2), 0)
+        { }
+
+        auto record(uint64_t value) noexcept -> void {
+            auto exponent = 0u;
+            while ((value >> exponent) >= SUB_BUCKETS) {
+                ++exponent;
+            }
+
+            if (exponent > MAX_EXPONENT) {
+                exponent = MAX_EXPONENT;
+                value = (SUB_BUCKETS << MAX_EXPONENT) - 1;
+            }
+
+            ++counts_[(exponent * HALF) + (value >> exponent)];
+            ++count_;
+            sum_ += value;
+            max_ = std::max(max_, value);
+        }
+
+        auto add(Histogram const& other) noexcept -> void {
+            for (size_t i = 0; i < counts_.size(); ++i) {
+                counts_[i] += other.counts_[i];
+            }
+
+            count_ += other.count_;
+            sum_ += other.sum_;
+            max_ = std::max(max_, other.max_);
+        }
+
+        // The highest value that is equivalent, at this precision, to
+        // the value at percentile `p`...
+        auto percentile(double p) const noexcept -> uint64_t {
+            if (!count_) {
+                return 0;
+            }
+
+            auto const wanted = std::max(
+                static_cast<uint64_t>(std::ceil(p / 100.0 * count_)),
+                uint64_t { 1 });
+
+            auto seen = uint64_t { 0 };
+            for (size_t i = 0; i < counts_.size(); ++i) {
+                seen += counts_[i];
+                if (seen >= wanted) {
+                    return std::min(highest_equivalent(i), max_);
+                }
+            }
+
+            return max_;
+        }
+
+        inline auto count() const noexcept -> uint64_t
+        { return count_; }
+
+        inline auto mean() const noexcept -> double
+        { return count_ ? static_cast<double>(sum_) / count_ : 0.0; }
+
+        inline auto max() const noexcept -> uint64_t
+        { return max_; }
+
+    private:
+        static auto highest_equivalent(size_t index) noexcept -> uint64_t {
+            auto const exponent = index < SUB_BUCKETS
+                ? 0u
+                : static_cast<unsigned>(index / HALF - 1);
+            auto const sub = index - exponent * HALF;
+            return ((sub + 1) << exponent) - 1;
+        }
+
+        std::vector<uint64_t> counts_;
+        uint64_t count_ = 0;
+        uint64_t sum_ = 0;
+        uint64_t max_ = 0;
+    };
+
+    constexpr unsigned Histogram::SUB_BUCKET_BITS;
+    constexpr uint64_t Histogram::SUB_BUCKETS;
+    constexpr uint64_t Histogram::HALF;
+    constexpr unsigned Histogram::MAX_EXPONENT;
+
+    struct Options {
+        size_t connections = 16;
+        size_t threads = 0;
+        size_t depth = 1;
+        double duration = 10.0;
+        double rate = 0.0;
+        std::string path = "/";
+        size_t body = 0;
+        std::string host = "127.0.0.1";
+        uint16_t port = 0;
+    };
+
+    auto make_request(Options const& options) -> std::string {
+        auto headers = http::HeaderContainer {
+            { "Host", options.host },
+            { "User-Agent", "http_load" },
+        };
+
+        if (options.body) {
+            headers.emplace_back("Content-Length",
+                                 std::to_string(options.body));
+        }
+
+        auto const request = http::HttpRequestBuilder { }
+            .with_protocol({
+                options.body ? http::Method::Post : http::Method::Get,
+                options.path,
+                http::Version::Http11
+            })
+            .with_headers(std::move(headers))
+            .build(http::BodyContainer(options.body, 'x'));
+
+        auto os = std::ostringstream { };
+        os << request;
+        return os.str();
+    }
+
+    // The built-in server...
+
+    auto make_response() -> std::string {
+        auto const body = std::string { "OK" };
+        auto const response = http::HttpResponseBuilder { }
+            .with_protocol({
+                http::Version::Http11,
+                static_cast<size_t>(200),
+                "OK"
+            })
+            .with_headers({
+                std::make_pair("Server", "http_load"),
+                std::make_pair("Content-Type", "text/plain"),
+                std::make_pair("Content-Length", std::to_string(body.size()))
+            })
+            .build(body.begin(), body.end());
+
+        auto os = std::ostringstream { };
+        os << response;
+        return os.str();
+    }
+
+    auto is_incomplete(std::error_code const& ec) noexcept -> bool {
+        return ec == make_error_code(http::ParseError::INVALID_EOF_STATE);
+    }
+
+    auto serve(tools::Socket connection, std::string const& response)
+        -> void
+    {
+        auto input = std::string { };
+        auto output = std::string { };
+        char buffer[64 * 1024];
+
+        for (;;) {
+            auto const n = tools::read_some(connection, buffer, sizeof(buffer));
+            if (!n) {
+                return;
+            }
+
+            input.append(buffer, n);
+
+            // Answer every complete request that has arrived with one
+            // write, so that pipelined requests are answered together...
+            auto offset = size_t { 0 };
+            while (offset < input.size()) {
+                auto result = http::parse_request<http::Capture::None>(
+                    input.data() + offset,
+                    input.data() + input.size());
+                if (!result) {
+                    if (is_incomplete(result::error(std::move(result)))) {
+                        break;
+                    }
+
+                    return;
+                }
+
+                offset += std::get<1>(result::value(std::move(result)));
+                output += response;
+            }
+
+            input.erase(0, offset);
+
+            if (!output.empty()) {
+                if (!tools::write_all(connection,
+                                      output.data(),
+                                      output.size()))
+                {
+                    return;
+                }
+
+                output.clear();
+            }
+        }
+    }
+
+    // Starts the built-in server, and returns the port it listens on...
+    auto start_server() -> uint16_t {
+        auto listener = tools::listen_loopback(0);
+        auto const port = tools::local_port(listener);
+
+        std::thread {
+            [](tools::Socket listener) {
+                auto const response = make_response();
+                for (;;) {
+                    std::thread {
+                        serve,
+                        tools::accept(listener),
+                        std::cref(response)
+                    }.detach();
+                }
+            },
+            std::move(listener)
+        }.detach();
+
+        return port;
+    }
+
+    // The load...
+
+    struct Connection {
+        tools::Socket socket;
+        std::string input;
+
+        // When each request in flight was sent or, in open-loop mode,
+        // scheduled to be sent...
+        std::deque<Clock::time_point> in_flight;
+
+        // Open-loop mode only...
+        Clock::time_point next_send;
+    };
+
+    struct Results {
+        Histogram latency;
+        uint64_t sent = 0;
+        uint64_t completed = 0;
+        uint64_t errors = 0;
+        uint64_t lost_connections = 0;
+
+        auto add(Results const& other) -> void {
+            latency.add(other.latency);
+            sent += other.sent;
+            completed += other.completed;
+            errors += other.errors;
+            lost_connections += other.lost_connections;
+        }
+    };
+
+    // Drives `count` connections, starting with global connection number
+    // `first`, from one thread...
+    auto run(Options const& options,
+             std::string const& request,
+             size_t first,
+             size_t count,
+             Clock::time_point start,
+             Clock::time_point end,
+             Results& results) -> void
+    {
+        // `depth` copies of the request, so that a pipeline of them can be
+        // sent with one write...
+        auto batch = std::string { };
+        for (size_t i = 0; i < options.depth; ++i) {
+            batch += request;
+        }
+
+        auto const open_loop = options.rate > 0;
+        auto const interval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double> {
+                open_loop ? options.connections / options.rate : 0.0
+            });
+
+        auto connections = std::vector<Connection>(count);
+        for (size_t i = 0; i < count; ++i) {
+            connections[i].socket = tools::connect(options.host.c_str(),
+                                                   options.port);
+
+            // Stagger the connections' schedules, so that the requests
+            // are spread evenly over time...
+            connections[i].next_send = start +
+                interval * static_cast<Clock::rep>(first + i) /
+                    static_cast<Clock::rep>(options.connections);
+        }
+
+        auto const lose = [&](Connection& c) {
+            results.errors += c.in_flight.size();
+            ++results.lost_connections;
+            c.in_flight.clear();
+            c.socket.close();
+        };
+
+        auto fds = std::vector<pollfd>(count);
+        char buffer[64 * 1024];
+
+        for (;;) {
+            auto now = Clock::now();
+            if (now >= end) {
+                break;
+            }
+
+            auto wake = end;
+            for (auto& c : connections) {
+                if (!c.socket.is_open()) {
+                    continue;
+                }
+
+                auto n = size_t { 0 };
+                while (c.in_flight.size() < options.depth &&
+                       (!open_loop || c.next_send <= now))
+                {
+                    c.in_flight.push_back(open_loop ? c.next_send : now);
+                    c.next_send += interval;
+                    ++n;
+                }
+
+                if (n && !tools::write_all(c.socket,
+                                           batch.data(),
+                                           n * request.size()))
+                {
+                    lose(c);
+                    continue;
+                }
+
+                results.sent += n;
+
+                if (open_loop && c.in_flight.size() < options.depth) {
+                    wake = std::min(wake, c.next_send);
+                }
+            }
+
+            for (size_t i = 0; i < count; ++i) {
+                fds[i].fd = connections[i].socket.is_open()
+                    ? connections[i].socket.get()
+                    : -1;
+                fds[i].events = POLLIN;
+                fds[i].revents = 0;
+            }
+
+            auto const wait = std::chrono::duration_cast<
+                std::chrono::milliseconds>(wake - now).count();
+            if (::poll(fds.data(),
+                       fds.size(),
+                       static_cast<int>(std::min<decltype(wait)>(wait, 100)))
+                < 0)
+            {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                throw tools::system_error("poll");
+            }
+
+            now = Clock::now();
+            for (size_t i = 0; i < count; ++i) {
+                auto& c = connections[i];
+                if (!fds[i].revents || !c.socket.is_open()) {
+                    continue;
+                }
+
+                auto const n = tools::read_some(c.socket,
+                                                buffer,
+                                                sizeof(buffer));
+                if (!n) {
+                    lose(c);
+                    continue;
+                }
+
+                c.input.append(buffer, n);
+
+                auto offset = size_t { 0 };
+                while (offset < c.input.size() && !c.in_flight.empty()) {
+                    auto result = http::parse_response(
+                        c.input.data() + offset,
+                        c.input.data() + c.input.size());
+                    if (!result) {
+                        if (!is_incomplete(result::error(std::move(result)))) {
+                            lose(c);
+                        }
+
+                        break;
+                    }
+
+                    offset += std::get<1>(result::value(std::move(result)));
+
+                    results.latency.record(static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            now - c.in_flight.front()).count()));
+                    c.in_flight.pop_front();
+                    ++results.completed;
+                }
+
+                if (!c.socket.is_open()) {
+                    continue;
+                }
+
+                if (c.in_flight.empty() && offset < c.input.size()) {
+                    // Bytes that don't answer any request...
+                    lose(c);
+                    continue;
+                }
+
+                c.input.erase(0, offset);
+            }
+        }
+    }
+
+    auto report(Options const& options, Results const& results) -> void {
+        auto const& h = results.latency;
+        auto const us = [](uint64_t ns) { return ns / 1000.0; };
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << (options.rate > 0 ? "open" : "closed") << " loop, "
+                  << options.connections << " connections, "
+                  << options.threads << " threads, depth "
+                  << options.depth << ", " << options.duration << " s";
+        if (options.rate > 0) {
+            std::cout << ", target " << options.rate << " req/s";
+        }
+
+        std::cout << "\n"
+                  << "requests: " << results.sent << " sent, "
+                  << results.completed << " completed ("
+                  << (results.completed / options.duration) << " req/s), "
+                  << results.errors << " failed, "
+                  << results.lost_connections << " connections lost\n"
+                  << "latency (us): mean " << us(static_cast<uint64_t>(h.mean()))
+                  << "  p50 " << us(h.percentile(50))
+                  << "  p90 " << us(h.percentile(90))
+                  << "  p99 " << us(h.percentile(99))
+                  << "  p99.9 " << us(h.percentile(99.9))
+                  << "  p99.99 " << us(h.percentile(99.99))
+                  << "  max " << us(h.max()) << "\n";
+    }
+
+    auto usage() -> int {
+        std::cerr << "usage: http_load [--connections n] [--threads n] "
+                     "[--depth n] [--duration s] [--rate r] [--path p] "
+                     "[--body bytes] [--host address] [port]\n";
+        return 2;
+    }
+}
+
+auto main(int argc, char** argv) -> int {
+    auto options = Options { };
+
+    for (auto i = 1; i < argc; ++i) {
+        auto const arg = std::string { argv[i] };
+        auto const* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto const has_value = value != nullptr && arg.compare(0, 2, "--") == 0;
+
+        if (arg == "--connections" && has_value) {
+            options.connections = std::strtoul(value, nullptr, 10);
+        }
+        else if (arg == "--threads" && has_value) {
+            options.threads = std::strtoul(value, nullptr, 10);
+        }
+        else if (arg == "--depth" && has_value) {
+            options.depth = std::strtoul(value, nullptr, 10);
+        }
+        else if (arg == "--duration" && has_value) {
+            options.duration = std::strtod(value, nullptr);
+        }
+        else if (arg == "--rate" && has_value) {
+            options.rate = std::strtod(value, nullptr);
+        }
+        else if (arg == "--path" && has_value) {
+            options.path = value;
+        }
+        else if (arg == "--body" && has_value) {
+            options.body = std::strtoul(value, nullptr, 10);
+        }
+        else if (arg == "--host" && has_value) {
+            options.host = value;
+        }
+        else if (arg.compare(0, 2, "--") != 0 && i == argc - 1) {
+            options.port = static_cast<uint16_t>(
+                std::strtoul(arg.c_str(), nullptr, 10));
+            continue;
+        }
+        else {
+            return usage();
+        }
+
+        ++i;
+    }
+
+    if (!options.connections || !options.depth || options.duration <= 0) {
+        return usage();
+    }
+
+    if (!options.threads) {
+        options.threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    options.threads = std::min(options.threads, options.connections);
+
+    try {
+        tools::ignore_sigpipe();
+
+        if (!options.port) {
+            options.host = "127.0.0.1";
+            options.port = start_server();
+            std::cerr << "built-in server on 127.0.0.1:" << options.port
+                      << "\n";
+        }
+
+        auto const request = make_request(options);
+        auto const start = Clock::now() + std::chrono::milliseconds { 100 };
+        auto const end = start + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double> { options.duration });
+
+        auto results = std::vector<Results>(options.threads);
+        auto errors = std::vector<std::string>(options.threads);
+        auto threads = std::vector<std::thread> { };
+
+        auto first = size_t { 0 };
+        for (size_t t = 0; t < options.threads; ++t) {
+            auto const count = options.connections / options.threads +
+                (t < options.connections % options.threads ? 1 : 0);
+
+            threads.emplace_back([&, t, first, count] {
+                try {
+                    run(options, request, first, count, start, end, results[t]);
+                }
+                catch (std::exception const& e) {
+                    errors[t] = e.what();
+                }
+            });
+
+            first += count;
+        }
+
+        auto total = Results { };
+        for (size_t t = 0; t < options.threads; ++t) {
+            threads[t].join();
+            if (!errors[t].empty()) {
+                std::cerr << "thread " << t << ": " << errors[t] << "\n";
+            }
+
+            total.add(results[t]);
+        }
+
+        report(options, total);
+    }
+    catch (std::exception const& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+#ifndef HTTP_TOOLS_SOCKET_HPP_INCLUDED
+#define HTTP_TOOLS_SOCKET_HPP_INCLUDED
+
+// The little bit of POSIX socket handling the tools need. Failures throw
+// `std::system_error`...
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+
+namespace tools {
+
+    inline auto system_error(char const* what) -> std::system_error {
+        return std::system_error { errno, std::generic_category(), what };
+    }
+
+    // An owned socket descriptor...
+    struct Socket {
+        Socket() = default;
+
+        explicit Socket(int fd) noexcept :
+            fd_ { fd }
+        { }
+
+        Socket(Socket&& other) noexcept :
+            fd_ { other.fd_ }
+        {
+            other.fd_ = -1;
+        }
+
+        auto operator=(Socket&& other) noexcept -> Socket& {
+            if (this != &other) {
+                close();
+                fd_ = other.fd_;
+                other.fd_ = -1;
+            }
+
+            return *this;
+        }
+
+        ~Socket() {
+            close();
+        }
+
+        inline auto get() const noexcept -> int
+        { return fd_; }
+
+        inline auto is_open() const noexcept -> bool
+        { return fd_ >= 0; }
+
+        auto close() noexcept -> void {
+            if (fd_ >= 0) {
+                ::close(fd_);
+                fd_ = -1;
+            }
+        }
+
+    private:
+        int fd_ = -1;
+    };
+
+    // Writing to a connection the peer has closed should fail, rather
+    // than kill the tool...
+    inline auto ignore_sigpipe() noexcept -> void {
+        std::signal(SIGPIPE, SIG_IGN);
+    }
+
+    inline auto make_address(char const* host, uint16_t port)
+        -> sockaddr_in
+    {
+        auto address = sockaddr_in { };
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        if (inet_pton(AF_INET, host, &address.sin_addr) != 1) {
+            throw std::system_error {
+                std::make_error_code(std::errc::invalid_argument),
+                host
+            };
+        }
+
+        return address;
+    }
+
+    // Listens on `127.0.0.1:port`. A `port` of 0 picks a free one (see
+    // `local_port()`)...
+    inline auto listen_loopback(uint16_t port) -> Socket {
+        auto s = Socket { ::socket(AF_INET, SOCK_STREAM, 0) };
+        if (!s.is_open()) {
+            throw system_error("socket");
+        }
+
+        auto const on = 1;
+        ::setsockopt(s.get(), SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        auto address = make_address("127.0.0.1", port);
+        if (::bind(s.get(),
+                   reinterpret_cast<sockaddr const*>(&address),
+                   sizeof(address)) != 0)
+        {
+            throw system_error("bind");
+        }
+
+        if (::listen(s.get(), SOMAXCONN) != 0) {
+            throw system_error("listen");
+        }
+
+        return s;
+    }
+
+    inline auto local_port(Socket const& s) -> uint16_t {
+        auto address = sockaddr_in { };
+        auto size = static_cast<socklen_t>(sizeof(address));
+        if (::getsockname(s.get(),
+                          reinterpret_cast<sockaddr*>(&address),
+                          &size) != 0)
+        {
+            throw system_error("getsockname");
+        }
+
+        return ntohs(address.sin_port);
+    }
+
+    // Disables Nagle's algorithm; the tools write whole messages, and
+    // measure latency...
+    inline auto set_no_delay(Socket const& s) noexcept -> void {
+        auto const on = 1;
+        ::setsockopt(s.get(), IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+
+    inline auto accept(Socket const& listener) -> Socket {
+        auto s = Socket { ::accept(listener.get(), nullptr, nullptr) };
+        if (!s.is_open()) {
+            throw system_error("accept");
+        }
+
+        set_no_delay(s);
+        return s;
+    }
+
+    inline auto connect(char const* host, uint16_t port) -> Socket {
+        auto s = Socket { ::socket(AF_INET, SOCK_STREAM, 0) };
+        if (!s.is_open()) {
+            throw system_error("socket");
+        }
+
+        auto address = make_address(host, port);
+        if (::connect(s.get(),
+                      reinterpret_cast<sockaddr const*>(&address),
+                      sizeof(address)) != 0)
+        {
+            throw system_error("connect");
+        }
+
+        set_no_delay(s);
+        return s;
+    }
+
+    // Returns `false` if the connection failed before everything was
+    // written...
+    inline auto write_all(Socket const& s, void const* data, size_t size)
+        noexcept -> bool
+    {
+        auto const* p = static_cast<char const*>(data);
+        while (size) {
+            auto n = ::send(s.get(), p, size, 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+
+            if (n <= 0) {
+                return false;
+            }
+
+            p += n;
+            size -= static_cast<size_t>(n);
+        }
+
+        return true;
+    }
+
+    // Returns the number of bytes read; 0 at the end of the stream, or
+    // if the connection failed...
+    inline auto read_some(Socket const& s, void* data, size_t size)
+        noexcept -> size_t
+    {
+        for (;;) {
+            auto n = ::recv(s.get(), data, size, 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+
+            return n < 0 ? 0 : static_cast<size_t>(n);
+        }
+    }
+}
+
+#endif //HTTP_TOOLS_SOCKET_HPP_INCLUDED